@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+GDB remote protocol end-to-end throughput benchmark, covered by GNU GPLv2 or later
+
+Connects to the OpenOCD GDB port of a halted target and measures how many
+reply bytes per second reach the client for the 'm' (memory read), 'g'
+(register read) and qXfer:features:read (target description) packets.
+
+The figures cover the whole round trip: the socket, the target and adapter
+accesses behind each packet, and the server side checksum and escaping.
+They do not isolate the cost of any single stage; use a qXfer of the
+target description, which needs no target access, to get closest to the
+packet formatting path alone.
+
+Example:
+./gdb_e2e_bench.py --addr 0x20000000 --len 1024 --count 200
+m     200 x  2048 bytes:   1234567 bytes/s
+g     200 x   336 bytes:    456789 bytes/s
+qXfer 200 x  4096 bytes:   2345678 bytes/s
+"""
+
+import argparse
+import socket
+import time
+
+
+class GdbRemote:
+    def __init__(self, host, port, noack):
+        self.sock = socket.create_connection((host, port))
+        self.buf = b""
+        self.noack = False
+        self.packet_size = 1024
+        for feature in self.command("qSupported:multiprocess+").split(b";"):
+            if feature.startswith(b"PacketSize="):
+                self.packet_size = int(feature[len(b"PacketSize="):], 16)
+        if noack and self.command("QStartNoAckMode") == b"OK":
+            self.noack = True
+
+    def _recv(self):
+        data = self.sock.recv(65536)
+        if not data:
+            raise EOFError("connection closed by server")
+        self.buf += data
+
+    def send(self, payload):
+        checksum = sum(payload) & 0xff
+        self.sock.sendall(b"$" + payload + b"#%02x" % checksum)
+        if not self.noack:
+            while not self.buf:
+                self._recv()
+            if self.buf[:1] != b"+":
+                raise IOError("packet not acknowledged: %r" % self.buf[:1])
+            self.buf = self.buf[1:]
+
+    def receive(self):
+        while True:
+            start = self.buf.find(b"$")
+            if start >= 0:
+                end = self.buf.find(b"#", start)
+                if end >= 0 and len(self.buf) >= end + 3:
+                    break
+            self._recv()
+        payload = self.buf[start + 1:end]
+        checksum = int(self.buf[end + 1:end + 3], 16)
+        self.buf = self.buf[end + 3:]
+        if checksum != sum(payload) & 0xff:
+            raise IOError("bad checksum in reply")
+        if not self.noack:
+            self.sock.sendall(b"+")
+        return payload
+
+    def command(self, payload):
+        self.send(payload.encode() if isinstance(payload, str) else payload)
+        return self.receive()
+
+
+def measure(gdb, name, payload, count):
+    reply_bytes = 0
+    start = time.perf_counter()
+    for _ in range(count):
+        reply = gdb.command(payload)
+        if reply.startswith(b"E"):
+            raise IOError("%s failed: %r" % (name, reply))
+        reply_bytes += len(reply)
+    elapsed = time.perf_counter() - start
+    print("%-5s %d x %5d bytes: %9d bytes/s" %
+          (name, count, reply_bytes // count, reply_bytes / elapsed))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=3333)
+    parser.add_argument("--addr", type=lambda x: int(x, 0), default=0)
+    parser.add_argument("--len", type=lambda x: int(x, 0), default=1024)
+    parser.add_argument("--count", type=int, default=100)
+    parser.add_argument("--ack", action="store_true",
+                        help="keep the acknowledgement mode enabled")
+    args = parser.parse_args()
+
+    gdb = GdbRemote(args.host, args.port, not args.ack)
+    measure(gdb, "m", "m%x,%x" % (args.addr, args.len), args.count)
+    measure(gdb, "g", "g", args.count)
+    # leave room for the 'm'/'l' prefix and the packet framing
+    chunk = min(args.len * 2, gdb.packet_size - 16)
+    measure(gdb, "qXfer", "qXfer:features:read:target.xml:0,%x" % chunk,
+            args.count)
+    gdb.sock.close()
+
+
+if __name__ == "__main__":
+    main()
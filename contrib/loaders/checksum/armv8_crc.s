@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+	parameters:
+	x0 - address in - crc out
+	x1 - char count
+
+	The host writes the 1 KiB lookup table right behind the code.
+*/
+
+	.text
+	.arch	armv8-a
+
+	.align	2
+
+start:
+	adr	x2, table
+	mov	w4, #0xffffffff		/* crc */
+	cbz	x1, done
+
+byte_loop:
+	ldrb	w5, [x0], #1
+	eor	w5, w5, w4, lsr #24
+	ldr	w5, [x2, w5, uxtw #2]
+	eor	w4, w5, w4, lsl #8
+	subs	x1, x1, #1
+	b.ne	byte_loop
+
+done:
+	mov	w0, w4
+	hlt	#0
+
+	.align	2
+table:
+
+	.end
@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+	parameters:
+	x0 - pointer to struct { uint64_t size_in_result_out, uint64_t addr }
+	w1 - value to check
+*/
+
+	.text
+	.arch	armv8-a
+
+	.align	2
+
+BLOCK_SIZE_RESULT	= 0
+BLOCK_ADDRESS		= 8
+SIZEOF_STRUCT_BLOCK	= 16
+
+start:
+block_loop:
+	ldr	x2, [x0, #BLOCK_SIZE_RESULT]	/* get size */
+	cbz	x2, done
+
+	ldr	x3, [x0, #BLOCK_ADDRESS]	/* get address */
+
+word_loop:
+	ldr	w4, [x3], #4	/* read word */
+	cmp	w4, w1
+	b.ne	not_erased
+
+	subs	x2, x2, #1
+	b.ne	word_loop
+
+	mov	x4, #1		/* block is erased */
+save_result:
+	str	x4, [x0, #BLOCK_SIZE_RESULT]
+	add	x0, x0, #SIZEOF_STRUCT_BLOCK
+	b	block_loop
+
+not_erased:
+	mov	x4, #0
+	b	save_result
+
+done:
+	hlt	#0
+
+	.end
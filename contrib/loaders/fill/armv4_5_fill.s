@@ -0,0 +1,37 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+	parameters:
+	r0 - address, 8 byte aligned
+	r1 - byte count, non-zero multiple of 8
+	r2, r3 - 8 byte pattern
+*/
+
+	.text
+	.arm
+
+	.align	2
+
+start:
+fill_loop:
+	stmia	r0!, {r2, r3}
+	subs	r1, r1, #8
+	bne	fill_loop
+
+done:
+	bkpt	#0
+
+	.end
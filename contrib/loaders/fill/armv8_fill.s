@@ -0,0 +1,37 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+	parameters:
+	x0 - address, 8 byte aligned
+	x1 - byte count, non-zero multiple of 8
+	x2 - 8 byte pattern
+*/
+
+	.text
+	.arch	armv8-a
+
+	.align	2
+
+start:
+fill_loop:
+	str	x2, [x0], #8
+	subs	x1, x1, #8
+	b.ne	fill_loop
+
+done:
+	hlt	#0
+
+	.end
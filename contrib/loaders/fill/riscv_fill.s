@@ -0,0 +1,41 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+	parameters:
+	a0 - address, 8 byte aligned
+	a1 - byte count, non-zero multiple of 8
+	a2, a3 - 8 byte pattern
+
+	Only uses RV32I instructions, so it runs on RV64 harts as well.
+*/
+
+	.text
+	.option	norvc
+
+	.align	2
+
+start:
+fill_loop:
+	sw	a2, 0(a0)
+	sw	a3, 4(a0)
+	addi	a0, a0, 8
+	addi	a1, a1, -8
+	bnez	a1, fill_loop
+
+done:
+	ebreak
+
+	.end
@@ -700,19 +700,13 @@ static int stm32l4_write_block(struct flash_bank *bank, const uint8_t *buffer,
 #include "../../../contrib/loaders/flash/stm32/stm32l4x.inc"
 	};
 
-	if (target_alloc_working_area(target, sizeof(stm32l4_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
+	retval = target_alloc_resident_working_area(target, "stm32l4x_write",
+			stm32l4_flash_write_code, sizeof(stm32l4_flash_write_code),
+			&write_algorithm);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
 		LOG_WARNING("no working area available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-			sizeof(stm32l4_flash_write_code),
-			stm32l4_flash_write_code);
-	if (retval != ERROR_OK) {
-		target_free_working_area(target, write_algorithm);
+	if (retval != ERROR_OK)
 		return retval;
-	}
 
 	/* memory buffer, size *must* be multiple of dword plus one dword for rp and one for wp */
 	buffer_size = target_get_working_area_avail(target) & ~(2 * sizeof(uint32_t) - 1);
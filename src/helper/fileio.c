@@ -189,6 +189,21 @@ int fileio_read(struct fileio *fileio, size_t size, void *buffer,
 	return fileio_local_read(fileio, size, buffer, size_read);
 }
 
+int fileio_read_at(struct fileio *fileio, size_t position, size_t size,
+		void *buffer, size_t *size_read)
+{
+	*size_read = 0;
+
+	if (fseek(fileio->file, position, SEEK_SET) != 0)
+		return ERROR_FILEIO_OPERATION_FAILED;
+
+	*size_read = fread(buffer, 1, size, fileio->file);
+	if (*size_read < size && ferror(fileio->file))
+		return ERROR_FILEIO_OPERATION_FAILED;
+
+	return ERROR_OK;
+}
+
 int fileio_read_u32(struct fileio *fileio, uint32_t *data)
 {
 	int retval;
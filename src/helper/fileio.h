@@ -53,6 +53,10 @@ int fileio_fgets(struct fileio *fileio, size_t size, void *buffer);
 
 int fileio_read(struct fileio *fileio,
 		size_t size, void *buffer, size_t *size_read);
+/* Seek and read without logging, for use from a helper thread while no
+ * other thread accesses the file. */
+int fileio_read_at(struct fileio *fileio, size_t position, size_t size,
+		void *buffer, size_t *size_read);
 int fileio_write(struct fileio *fileio,
 		size_t size, const void *buffer, size_t *size_written);
 
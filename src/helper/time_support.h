@@ -42,6 +42,8 @@ int timeval_compare(const struct timeval *x, const struct timeval *y);
 
 /** @returns gettimeofday() timeval as 64-bit in ms */
 int64_t timeval_ms(void);
+/** @returns monotonic clock as 64-bit in ms, immune to wall-clock changes */
+int64_t monotonic_ms(void);
 
 struct duration {
 	struct timeval start;
@@ -28,6 +28,12 @@
 
 #include "time_support.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 /* simple and low overhead fetching of ms counter. Use only
  * the difference between ms counters returned from this fn.
  */
@@ -39,3 +45,20 @@ int64_t timeval_ms(void)
 		return retval;
 	return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
 }
+
+/* ms counter which never jumps with wall-clock adjustments; like
+ * timeval_ms(), only differences between two values are meaningful.
+ */
+int64_t monotonic_ms(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, count;
+	if (QueryPerformanceFrequency(&frequency) && QueryPerformanceCounter(&count))
+		return count.QuadPart * 1000 / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec now;
+	if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+		return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+	return timeval_ms();
+}
@@ -250,10 +250,22 @@ static int hwthread_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	}
 
 	for (int i = 0; i < *rtos_reg_list_size; i++) {
-		(*rtos_reg_list)[i].number = (*reg_list)[i].number;
-		(*rtos_reg_list)[i].size = (*reg_list)[i].size;
-		memcpy((*rtos_reg_list)[i].value, (*reg_list)[i].value,
-				((*reg_list)[i].size + 7) / 8);
+		/* the target may not have read all registers on halt */
+		if (!reg_list[i]->valid) {
+			retval = reg_list[i]->type->get(reg_list[i]);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Couldn't read register %s of thread %" PRId64 ".",
+						reg_list[i]->name, thread_id);
+				free(*rtos_reg_list);
+				*rtos_reg_list = NULL;
+				free(reg_list);
+				return retval;
+			}
+		}
+		(*rtos_reg_list)[i].number = reg_list[i]->number;
+		(*rtos_reg_list)[i].size = reg_list[i]->size;
+		memcpy((*rtos_reg_list)[i].value, reg_list[i]->value,
+				(reg_list[i]->size + 7) / 8);
 	}
 	free(reg_list);
 
@@ -51,6 +51,13 @@
 #include <jtag/jtag.h>
 #include "rtos/rtos.h"
 #include "target/smp.h"
+#include <helper/time_support.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 /**
  * @file
@@ -71,9 +78,25 @@ struct gdb_connection {
 	char buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
 	char *buf_p;
 	int buf_cnt;
+	/* incoming packet, grown up to max_packet_size as needed */
+	char *packet;
+	size_t packet_alloc;
+	/* gdb_max_packet_size when the connection was accepted, as advertised */
+	unsigned int max_packet_size;
 	bool ctrl_c;
 	enum target_state frontend_state;
+	/* vFlashWrite data not programmed yet, see gdb_vflash_program() */
 	struct image *vflash_image;
+	/* set once TARGET_EVENT_GDB_FLASH_WRITE_START was sent for this load */
+	bool vflash_writing;
+	/* bytes programmed since the last vFlashDone */
+	uint32_t vflash_written;
+	/* everything below was programmed without erase, see gdb_vflash_program() */
+	target_addr_t vflash_programmed;
+	/* As for memory writes, a vFlashWrite is acknowledged before the data
+	 * is programmed, so GDB sends the next packet while the flash is busy.
+	 * A programming error is reported on the next vFlashWrite/vFlashDone. */
+	int vflash_error;
 	bool closed;
 	bool busy;
 	int noack_mode;
@@ -97,6 +120,9 @@ struct gdb_connection {
 	struct target_desc_format target_desc;
 	/* temporarily used for thread list support */
 	char *thread_list;
+	/* reply buffer reused across packets, see gdb_reply_buffer() */
+	char *reply;
+	size_t reply_size;
 };
 
 #if 0
@@ -142,6 +168,13 @@ static int gdb_report_register_access_error;
 /* enabled by default */
 static int gdb_use_target_description = 1;
 
+/* largest packet accepted from gdb, advertised as PacketSize */
+#define GDB_MAX_PACKET_SIZE_LIMIT (16 * 1024 * 1024)
+
+/* time after which a vCont;r range step reports a stop even inside the range */
+#define GDB_RANGE_STEP_BUDGET_MS 500
+static unsigned int gdb_max_packet_size = GDB_BUFFER_SIZE;
+
 /* current processing free-run type, used by file-I/O */
 static char gdb_running_type;
 
@@ -357,10 +390,166 @@ static int gdb_write(struct connection *connection, void *data, int len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
+static int gdb_write_vec(struct connection *connection,
+		const struct connection_vec *vec, unsigned int count)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	if (gdb_con->closed)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	if (connection_write_vec(connection, vec, count) == ERROR_OK)
+		return ERROR_OK;
+	gdb_con->closed = true;
+	return ERROR_SERVER_REMOTE_CLOSED;
+}
+
+/*
+ * Returns the connection's reply buffer, grown to at least size bytes.
+ * Replies are built here instead of in per-packet allocations; the
+ * buffer is only valid until the next call.
+ */
+static char *gdb_reply_buffer(struct gdb_connection *gdb_con, size_t size)
+{
+	if (size > gdb_con->reply_size) {
+		char *reply = realloc(gdb_con->reply, size);
+		if (!reply)
+			return NULL;
+		gdb_con->reply = reply;
+		gdb_con->reply_size = size;
+	}
+
+	return gdb_con->reply;
+}
+
+/* Sum of all bytes modulo 256, as used for the packet checksum. */
+static unsigned char gdb_checksum(const char *buffer, size_t len)
+{
+	size_t i = 0;
+	uint32_t sum = 0;
+
+#if defined(__SSE2__)
+	/* PSADBW adds up eight bytes into each 64 bit half */
+	__m128i acc = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(buffer + i));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(v, _mm_setzero_si128()));
+	}
+	sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#elif defined(__ARM_NEON)
+	/* 16 bit lanes may wrap, that does not change the sum modulo 256 */
+	uint16x8_t acc = vdupq_n_u16(0);
+	for (; i + 16 <= len; i += 16)
+		acc = vpadalq_u8(acc, vld1q_u8((const uint8_t *)buffer + i));
+	uint64x2_t acc64 = vpaddlq_u32(vpaddlq_u16(acc));
+	sum = vgetq_lane_u64(acc64, 0) + vgetq_lane_u64(acc64, 1);
+#else
+	/* eight bytes at a time, pairwise into 16 bit lanes which are folded
+	 * before they can carry into each other */
+	while (i + 8 <= len) {
+		uint64_t acc = 0;
+		for (unsigned int n = 0; n < 128 && i + 8 <= len; n++, i += 8) {
+			uint64_t w;
+			memcpy(&w, buffer + i, sizeof(w));
+			acc += (w & 0x00ff00ff00ff00ffULL) + ((w >> 8) & 0x00ff00ff00ff00ffULL);
+		}
+		for (; acc; acc >>= 16)
+			sum += acc & 0xffff;
+	}
+#endif
+
+	for (; i < len; i++)
+		sum += (unsigned char)buffer[i];
+
+	return sum & 0xff;
+}
+
+static inline bool gdb_needs_escape(uint8_t c)
+{
+	return c == '#' || c == '$' || c == '}' || c == '*';
+}
+
+/*
+ * Escape len bytes of binary data for a reply packet, see "Binary Data"
+ * in the GDB manual. The output takes at most 2 * len bytes; src may be
+ * located inside that output area, as long as it starts at least len
+ * bytes after dst, so data can be escaped in place. Blocks without any
+ * character to escape are copied a vector, or a word, at a time.
+ */
+static size_t gdb_escape_binary(char *dst, const uint8_t *src, size_t len)
+{
+	size_t out = 0;
+	size_t i = 0;
+
+	while (i < len) {
+#if defined(__SSE2__)
+		if (i + 16 <= len) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+			__m128i m = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('#')),
+						_mm_cmpeq_epi8(v, _mm_set1_epi8('$'))),
+					_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('}')),
+						_mm_cmpeq_epi8(v, _mm_set1_epi8('*'))));
+			if (!_mm_movemask_epi8(m)) {
+				_mm_storeu_si128((__m128i *)(dst + out), v);
+				out += 16;
+				i += 16;
+				continue;
+			}
+		}
+#elif defined(__ARM_NEON)
+		if (i + 16 <= len) {
+			uint8x16_t v = vld1q_u8(src + i);
+			uint8x16_t m = vorrq_u8(
+					vorrq_u8(vceqq_u8(v, vdupq_n_u8('#')), vceqq_u8(v, vdupq_n_u8('$'))),
+					vorrq_u8(vceqq_u8(v, vdupq_n_u8('}')), vceqq_u8(v, vdupq_n_u8('*'))));
+			uint8x8_t m8 = vorr_u8(vget_low_u8(m), vget_high_u8(m));
+			if (!vget_lane_u64(vreinterpret_u64_u8(m8), 0)) {
+				vst1q_u8((uint8_t *)dst + out, v);
+				out += 16;
+				i += 16;
+				continue;
+			}
+		}
+#else
+		if (i + 8 <= len) {
+			const uint64_t ones = 0x0101010101010101ULL;
+			const uint64_t highs = 0x8080808080808080ULL;
+			uint64_t w, hit = 0;
+
+			memcpy(&w, src + i, sizeof(w));
+			/* classic "has zero byte" test on w xor each special character */
+			const uint8_t special[] = { '#', '$', '}', '*' };
+			for (unsigned int n = 0; n < ARRAY_SIZE(special); n++) {
+				uint64_t x = w ^ (ones * special[n]);
+				hit |= (x - ones) & ~x & highs;
+			}
+			if (!hit) {
+				memcpy(dst + out, &w, sizeof(w));
+				out += 8;
+				i += 8;
+				continue;
+			}
+		}
+#endif
+		/* a block with something to escape, or the tail: go bytewise */
+		size_t end = MIN(len, i + 16);
+		for (; i < end; i++) {
+			uint8_t c = src[i];
+
+			if (gdb_needs_escape(c)) {
+				dst[out++] = '}';
+				c ^= 0x20;
+			}
+			dst[out++] = c;
+		}
+	}
+
+	return out;
+}
+
 static int gdb_put_packet_inner(struct connection *connection,
 		char *buffer, int len)
 {
-	int i;
 	unsigned char my_checksum = 0;
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
@@ -369,8 +558,7 @@ static int gdb_put_packet_inner(struct connection *connection,
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
 
-	for (i = 0; i < len; i++)
-		my_checksum += buffer[i];
+	my_checksum = gdb_checksum(buffer, len);
 
 #ifdef _DEBUG_GDB_IO_
 	/*
@@ -417,15 +605,14 @@ static int gdb_put_packet_inner(struct connection *connection,
 				return retval;
 		} else {
 			/* larger packets are transmitted directly from caller supplied buffer
-			 * by several calls to gdb_write() to avoid dynamic allocation */
+			 * by a single gathered write to avoid dynamic allocation and copies */
 			snprintf(local_buffer + 1, sizeof(local_buffer) - 1, "#%02x", my_checksum);
-			retval = gdb_write(connection, local_buffer, 1);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = gdb_write(connection, buffer, len);
-			if (retval != ERROR_OK)
-				return retval;
-			retval = gdb_write(connection, local_buffer + 1, 3);
+			const struct connection_vec vec[] = {
+				{ local_buffer, 1 },
+				{ buffer, len },
+				{ local_buffer + 1, 3 },
+			};
+			retval = gdb_write_vec(connection, vec, ARRAY_SIZE(vec));
 			if (retval != ERROR_OK)
 				return retval;
 		}
@@ -493,8 +680,39 @@ int gdb_put_packet(struct connection *connection, char *buffer, int len)
 	return retval;
 }
 
+/* Make room for a packet of size bytes plus null-termination. */
+static int gdb_packet_reserve(struct gdb_connection *gdb_con, size_t size)
+{
+	if (size < gdb_con->packet_alloc)
+		return ERROR_OK;
+
+	if (size > gdb_con->max_packet_size) {
+		LOG_ERROR("packet buffer too small");
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+	}
+
+	size_t alloc = 2 * gdb_con->packet_alloc;
+	if (alloc < GDB_BUFFER_SIZE + 1)
+		alloc = GDB_BUFFER_SIZE + 1;
+	if (alloc < size + 1)
+		alloc = size + 1;
+	if (alloc > (size_t)gdb_con->max_packet_size + 1)
+		alloc = (size_t)gdb_con->max_packet_size + 1;
+
+	char *packet = realloc(gdb_con->packet, alloc);
+	if (!packet) {
+		LOG_ERROR("Out of memory for a %zu bytes packet", size);
+		return ERROR_GDB_BUFFER_TOO_SMALL;
+	}
+	gdb_con->packet = packet;
+	gdb_con->packet_alloc = alloc;
+
+	return ERROR_OK;
+}
+
+/* Assemble the next packet into gdb_con->packet, growing it as needed. */
 static inline int fetch_packet(struct connection *connection,
-		int *checksum_ok, int noack, int *len, char *buffer)
+		int *checksum_ok, int noack, int *len)
 {
 	unsigned char my_checksum = 0;
 	char checksum[3];
@@ -503,20 +721,28 @@ static inline int fetch_packet(struct connection *connection,
 
 	struct gdb_connection *gdb_con = connection->priv;
 	my_checksum = 0;
-	int count = 0;
-	count = 0;
+	size_t count = 0;
 
 	/* move this over into local variables to use registers and give the
 	 * more freedom to optimize */
 	char *buf_p = gdb_con->buf_p;
 	int buf_cnt = gdb_con->buf_cnt;
+	char *buffer = gdb_con->packet;
 
 	for (;; ) {
 		/* The common case is that we have an entire packet with no escape chars.
 		 * We need to leave at least 2 bytes in the buffer to have
 		 * gdb_get_char() update various bits and bobs correctly.
 		 */
-		if ((buf_cnt > 2) && ((buf_cnt + count) < *len)) {
+		if (buf_cnt > 2) {
+			/* make room for all that was received, within the limit */
+			size_t want = count + buf_cnt;
+			if (want > gdb_con->max_packet_size)
+				want = gdb_con->max_packet_size;
+			if (gdb_packet_reserve(gdb_con, want) == ERROR_OK)
+				buffer = gdb_con->packet;
+		}
+		if ((buf_cnt > 2) && ((count + buf_cnt) < gdb_con->packet_alloc)) {
 			/* The compiler will struggle a bit with constant propagation and
 			 * aliasing, so we help it by showing that these values do not
 			 * change inside the loop
@@ -554,11 +780,12 @@ static inline int fetch_packet(struct connection *connection,
 			if (done)
 				break;
 		}
-		if (count > *len) {
-			LOG_ERROR("packet buffer too small");
-			retval = ERROR_GDB_BUFFER_TOO_SMALL;
+
+		/* one more character at most below */
+		retval = gdb_packet_reserve(gdb_con, count + 1);
+		if (retval != ERROR_OK)
 			break;
-		}
+		buffer = gdb_con->packet;
 
 		retval = gdb_get_char_fast(connection, &character, &buf_p, &buf_cnt);
 		if (retval != ERROR_OK)
@@ -608,8 +835,7 @@ static inline int fetch_packet(struct connection *connection,
 	return ERROR_OK;
 }
 
-static int gdb_get_packet_inner(struct connection *connection,
-		char *buffer, int *len)
+static int gdb_get_packet_inner(struct connection *connection, int *len)
 {
 	int character;
 	int retval;
@@ -662,11 +888,11 @@ static int gdb_get_packet_inner(struct connection *connection,
 		/* explicit code expansion here to get faster inlined code in -O3 by not
 		 * calculating checksum */
 		if (gdb_con->noack_mode) {
-			retval = fetch_packet(connection, &checksum_ok, 1, len, buffer);
+			retval = fetch_packet(connection, &checksum_ok, 1, len);
 			if (retval != ERROR_OK)
 				return retval;
 		} else {
-			retval = fetch_packet(connection, &checksum_ok, 0, len, buffer);
+			retval = fetch_packet(connection, &checksum_ok, 0, len);
 			if (retval != ERROR_OK)
 				return retval;
 		}
@@ -688,11 +914,12 @@ static int gdb_get_packet_inner(struct connection *connection,
 	return ERROR_OK;
 }
 
-static int gdb_get_packet(struct connection *connection, char *buffer, int *len)
+/* Receive the next packet into gdb_con->packet, its length goes to *len. */
+static int gdb_get_packet(struct connection *connection, int *len)
 {
 	struct gdb_connection *gdb_con = connection->priv;
 	gdb_con->busy = true;
-	int retval = gdb_get_packet_inner(connection, buffer, len);
+	int retval = gdb_get_packet_inner(connection, len);
 	gdb_con->busy = false;
 	return retval;
 }
@@ -942,9 +1169,16 @@ static int gdb_new_connection(struct connection *connection)
 	/* initialize gdb connection information */
 	gdb_connection->buf_p = gdb_connection->buffer;
 	gdb_connection->buf_cnt = 0;
+	gdb_connection->packet = NULL;
+	gdb_connection->packet_alloc = 0;
+	gdb_connection->max_packet_size = gdb_max_packet_size;
 	gdb_connection->ctrl_c = false;
 	gdb_connection->frontend_state = TARGET_HALTED;
 	gdb_connection->vflash_image = NULL;
+	gdb_connection->vflash_writing = false;
+	gdb_connection->vflash_written = 0;
+	gdb_connection->vflash_programmed = 0;
+	gdb_connection->vflash_error = ERROR_OK;
 	gdb_connection->closed = false;
 	gdb_connection->busy = false;
 	gdb_connection->noack_mode = 0;
@@ -955,6 +1189,8 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->target_desc.tdesc = NULL;
 	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
+	gdb_connection->reply = NULL;
+	gdb_connection->reply_size = 0;
 
 	/* send ACK to GDB for debug request */
 	gdb_write(connection, "+", 1);
@@ -1039,6 +1275,26 @@ static int gdb_new_connection(struct connection *connection)
 	return ERROR_OK;
 }
 
+/* Drop the state of a vFlash load, finishing the write events it started. */
+static void gdb_vflash_reset(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+
+	if (gdb_connection->vflash_writing)
+		target_call_event_callbacks(get_target_from_connection(connection),
+				TARGET_EVENT_GDB_FLASH_WRITE_END);
+
+	if (gdb_connection->vflash_image) {
+		image_close(gdb_connection->vflash_image);
+		free(gdb_connection->vflash_image);
+		gdb_connection->vflash_image = NULL;
+	}
+	gdb_connection->vflash_writing = false;
+	gdb_connection->vflash_written = 0;
+	gdb_connection->vflash_programmed = 0;
+	gdb_connection->vflash_error = ERROR_OK;
+}
+
 static int gdb_connection_closed(struct connection *connection)
 {
 	struct target *target;
@@ -1057,16 +1313,14 @@ static int gdb_connection_closed(struct connection *connection)
 		target_state_name(target),
 		gdb_actual_connections);
 
-	/* see if an image built with vFlash commands is left */
-	if (gdb_connection->vflash_image) {
-		image_close(gdb_connection->vflash_image);
-		free(gdb_connection->vflash_image);
-		gdb_connection->vflash_image = NULL;
-	}
+	/* see if a vFlash load was left unfinished */
+	gdb_vflash_reset(connection);
 
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, target);
 
+	free(gdb_connection->reply);
+	free(gdb_connection->packet);
 	free(connection->priv);
 	connection->priv = NULL;
 
@@ -1136,10 +1390,14 @@ static void gdb_str_to_target(struct target *target,
 	buf = reg->value;
 	buf_len = DIV_ROUND_UP(reg->size, 8);
 
+	static const char hex_digits[] = "0123456789abcdef";
+
 	for (i = 0; i < buf_len; i++) {
 		int j = gdb_reg_pos(target, i, buf_len);
-		tstr += sprintf(tstr, "%02x", buf[j]);
+		*tstr++ = hex_digits[buf[j] >> 4];
+		*tstr++ = hex_digits[buf[j] & 0xf];
 	}
+	*tstr = '\0';
 }
 
 /* copy over in register buffer */
@@ -1196,9 +1454,11 @@ static int gdb_get_registers_packet(struct connection *connection,
 
 	assert(reg_packet_size > 0);
 
-	reg_packet = malloc(reg_packet_size + 1); /* plus one for string termination null */
-	if (reg_packet == NULL)
+	reg_packet = gdb_reply_buffer(connection->priv, reg_packet_size + 1); /* plus one for string termination null */
+	if (reg_packet == NULL) {
+		free(reg_list);
 		return ERROR_FAIL;
+	}
 
 	reg_packet_p = reg_packet;
 
@@ -1209,7 +1469,6 @@ static int gdb_get_registers_packet(struct connection *connection,
 			retval = reg_list[i]->type->get(reg_list[i]);
 			if (retval != ERROR_OK && gdb_report_register_access_error) {
 				LOG_DEBUG("Couldn't get register %s.", reg_list[i]->name);
-				free(reg_packet);
 				free(reg_list);
 				return gdb_error(connection, retval);
 			}
@@ -1228,7 +1487,6 @@ static int gdb_get_registers_packet(struct connection *connection,
 #endif
 
 	gdb_put_packet(connection, reg_packet, reg_packet_size);
-	free(reg_packet);
 
 	free(reg_list);
 
@@ -1332,14 +1590,18 @@ static int gdb_get_register_packet(struct connection *connection,
 		}
 	}
 
-	reg_packet = calloc(DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2 + 1, 1); /* plus one for string termination null */
+	reg_packet = gdb_reply_buffer(connection->priv,
+			DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2 + 1); /* plus one for string termination null */
+	if (reg_packet == NULL) {
+		free(reg_list);
+		return ERROR_FAIL;
+	}
 
 	gdb_str_to_target(target, reg_packet, reg_list[reg_num]);
 
 	gdb_put_packet(connection, reg_packet, DIV_ROUND_UP(reg_list[reg_num]->size, 8) * 2);
 
 	free(reg_list);
-	free(reg_packet);
 
 	return ERROR_OK;
 }
@@ -1427,16 +1689,19 @@ static int gdb_error(struct connection *connection, int retval)
 /* We don't have to worry about the default 2 second timeout for GDB packets,
  * because GDB breaks up large memory reads into smaller reads.
  */
+/* Handles 'm' (hex reply) and 'x' (binary reply) memory read packets. */
 static int gdb_read_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
 	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
 	char *separator;
 	uint64_t addr = 0;
 	uint32_t len = 0;
+	bool binary = packet[0] == 'x';
 
 	uint8_t *buffer;
-	char *hex_buffer;
+	char *reply;
 
 	int retval = ERROR_OK;
 
@@ -1453,12 +1718,23 @@ static int gdb_read_memory_packet(struct connection *connection,
 	len = strtoul(separator + 1, NULL, 16);
 
 	if (!len) {
+		if (binary) {
+			gdb_put_packet(connection, "b", 1);
+			return ERROR_OK;
+		}
 		LOG_WARNING("invalid read memory packet received (len == 0)");
 		gdb_put_packet(connection, "", 0);
 		return ERROR_OK;
 	}
 
-	buffer = malloc(len);
+	/*
+	 * The raw data goes to the end of the reply buffer and is encoded
+	 * from there towards its start, two bytes per byte at most.
+	 */
+	reply = gdb_reply_buffer(gdb_con, 3 * (size_t)len + 1);
+	if (!reply)
+		return gdb_error(connection, ERROR_FAIL);
+	buffer = (uint8_t *)reply + 2 * (size_t)len + 1;
 
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
@@ -1483,18 +1759,19 @@ static int gdb_read_memory_packet(struct connection *connection,
 	}
 
 	if (retval == ERROR_OK) {
-		hex_buffer = malloc(len * 2 + 1);
-
-		size_t pkt_len = hexify(hex_buffer, buffer, len, len * 2 + 1);
+		size_t pkt_len;
 
-		gdb_put_packet(connection, hex_buffer, pkt_len);
+		if (binary) {
+			reply[0] = 'b';
+			pkt_len = 1 + gdb_escape_binary(reply + 1, buffer, len);
+		} else {
+			pkt_len = hexify(reply, buffer, len, 2 * (size_t)len + 1);
+		}
 
-		free(hex_buffer);
+		gdb_put_packet(connection, reply, pkt_len);
 	} else
 		retval = gdb_error(connection, retval);
 
-	free(buffer);
-
 	return retval;
 }
 
@@ -2346,14 +2623,10 @@ error:
 	return retval;
 }
 
-static int gdb_get_target_description_chunk(struct target *target, struct target_desc_format *target_desc,
+static int gdb_get_target_description_chunk(struct target *target, struct gdb_connection *gdb_con,
 		char **chunk, int32_t offset, uint32_t length)
 {
-	if (target_desc == NULL) {
-		LOG_ERROR("Unable to Generate Target Description");
-		return ERROR_FAIL;
-	}
-
+	struct target_desc_format *target_desc = &gdb_con->target_desc;
 	char *tdesc = target_desc->tdesc;
 	uint32_t tdesc_length = target_desc->tdesc_length;
 
@@ -2374,7 +2647,7 @@ static int gdb_get_target_description_chunk(struct target *target, struct target
 	else
 		transfer_type = 'l';
 
-	*chunk = malloc(length + 2);
+	*chunk = gdb_reply_buffer(gdb_con, length + 2);
 	if (*chunk == NULL) {
 		LOG_ERROR("Unable to allocate memory");
 		return ERROR_FAIL;
@@ -2495,9 +2768,11 @@ static int gdb_generate_thread_list(struct target *target, char **thread_list_ou
 	return retval;
 }
 
-static int gdb_get_thread_list_chunk(struct target *target, char **thread_list,
+static int gdb_get_thread_list_chunk(struct target *target, struct gdb_connection *gdb_con,
 		char **chunk, int32_t offset, uint32_t length)
 {
+	char **thread_list = &gdb_con->thread_list;
+
 	if (*thread_list == NULL) {
 		int retval = gdb_generate_thread_list(target, thread_list);
 		if (retval != ERROR_OK) {
@@ -2515,7 +2790,7 @@ static int gdb_get_thread_list_chunk(struct target *target, char **thread_list,
 	else
 		transfer_type = 'l';
 
-	*chunk = malloc(length + 2 + 3);
+	*chunk = gdb_reply_buffer(gdb_con, length + 2 + 3);
     /* Allocating extra 3 bytes prevents false positive valgrind report
 	 * of strlen(chunk) word access:
 	 * Invalid read of size 4
@@ -2627,8 +2902,8 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
-			GDB_BUFFER_SIZE,
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+;binary-upload+",
+			gdb_connection->max_packet_size,
 			((gdb_use_memory_map == 1) && (flash_get_bank_count() > 0)) ? '+' : '-',
 			(gdb_target_desc_supported == 1) ? '+' : '-');
 
@@ -2664,7 +2939,7 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_target_description_chunk(target, &gdb_connection->target_desc,
+		retval = gdb_get_target_description_chunk(target, gdb_connection,
 				&xml, offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
@@ -2673,7 +2948,6 @@ static int gdb_query_packet(struct connection *connection,
 
 		gdb_put_packet(connection, xml, strlen(xml));
 
-		free(xml);
 		return ERROR_OK;
 	} else if (strncmp(packet, "qXfer:threads:read:", 19) == 0) {
 		char *xml = NULL;
@@ -2695,7 +2969,7 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_thread_list_chunk(target, &gdb_connection->thread_list,
+		retval = gdb_get_thread_list_chunk(target, gdb_connection,
 						   &xml, offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
@@ -2704,7 +2978,6 @@ static int gdb_query_packet(struct connection *connection,
 
 		gdb_put_packet(connection, xml, strlen(xml));
 
-		free(xml);
 		return ERROR_OK;
 	} else if (strncmp(packet, "QStartNoAckMode", 15) == 0) {
 		gdb_connection->noack_mode = 1;
@@ -2716,6 +2989,55 @@ static int gdb_query_packet(struct connection *connection,
 	return ERROR_OK;
 }
 
+/*
+ * Step 'target' while its PC stays in [start, end). Stops early on a
+ * breakpoint, on a halt for another reason than the step, or when the
+ * time budget is spent; gdb accepts a stop inside the range and simply
+ * re-issues the range step.
+ */
+static int gdb_range_step(struct target *target, target_addr_t start, target_addr_t end)
+{
+	int64_t then = timeval_ms();
+	unsigned int steps = 0;
+	int retval;
+
+	for (;;) {
+		retval = target_step(target, 1, 0, 0);
+		if (retval != ERROR_OK)
+			return retval;
+		steps++;
+
+		/* some targets (e.g. Cortex-A) report a step as a breakpoint */
+		if (target->state != TARGET_HALTED
+				|| (target->debug_reason != DBG_REASON_SINGLESTEP
+					&& target->debug_reason != DBG_REASON_BREAKPOINT))
+			break;
+
+		struct reg *pc = register_get_by_name(target->reg_cache, "pc", true);
+		if (pc == NULL)
+			break;
+		if (!pc->valid) {
+			retval = pc->type->get(pc);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		target_addr_t addr = buf_get_u64(pc->value, 0, MIN(pc->size, 64));
+
+		if (addr < start || addr >= end)
+			break;
+		if (breakpoint_find(target, addr) != NULL)
+			break;
+		if (timeval_ms() - then > GDB_RANGE_STEP_BUDGET_MS)
+			break;
+
+		keep_alive();
+	}
+
+	LOG_DEBUG("target %s range-stepped %u instructions in [" TARGET_ADDR_FMT ", "
+			TARGET_ADDR_FMT ")", target_name(target), steps, start, end);
+	return ERROR_OK;
+}
+
 static bool gdb_handle_vcont_packet(struct connection *connection, const char *packet, int packet_size)
 {
 	struct gdb_connection *gdb_connection = connection->priv;
@@ -2727,7 +3049,7 @@ static bool gdb_handle_vcont_packet(struct connection *connection, const char *p
 	if (parse[0] == '?') {
 		if (target->type->step != NULL) {
 			/* gdb doesn't accept c without C and s without S */
-			gdb_put_packet(connection, "vCont;c;C;s;S", 13);
+			gdb_put_packet(connection, "vCont;c;C;s;S;r", 15);
 			return true;
 		}
 		return false;
@@ -2765,6 +3087,73 @@ static bool gdb_handle_vcont_packet(struct connection *connection, const char *p
 		return true;
 	}
 
+	/* range step: step locally while the pc is in [start, end) */
+	if (parse[0] == 'r') {
+		struct target *ct = target;
+		target_addr_t start, end;
+		char *endp;
+
+		gdb_running_type = 's';
+
+		start = strtoull(parse + 1, &endp, 16);
+		if (*endp != ',') {
+			LOG_ERROR("incomplete vCont;r packet received, dropping connection");
+			return false;
+		}
+		end = strtoull(endp + 1, &endp, 16);
+
+		if (*endp == ':' && target->rtos != NULL) {
+			int64_t thread_id = strtoll(endp + 1, &endp, 16);
+
+			rtos_update_threads(target);
+			target->rtos->gdb_target_for_threadid(connection, thread_id, &ct);
+
+			/* same as for 's', a step of a thread that isn't running can't be done */
+			if (target->rtos->current_thread != thread_id) {
+				char sig_reply[128];
+				int sig_reply_len;
+
+				LOG_DEBUG("fake range step thread %"PRIx64, thread_id);
+				sig_reply_len = snprintf(sig_reply, sizeof(sig_reply),
+						"T05thread:%016"PRIx64";", thread_id);
+				gdb_put_packet(connection, sig_reply, sig_reply_len);
+				return true;
+			}
+		}
+
+		LOG_DEBUG("target %s range step [" TARGET_ADDR_FMT ", " TARGET_ADDR_FMT ")",
+				target_name(ct), start, end);
+		log_add_callback(gdb_log_callback, connection);
+		target_call_event_callbacks(ct, TARGET_EVENT_GDB_START);
+
+		/* support for gdb_sync command */
+		if (gdb_connection->sync) {
+			gdb_connection->sync = false;
+			if (ct->state == TARGET_HALTED) {
+				LOG_DEBUG("range step ignored. GDB will now fetch the register state "
+								"from the target.");
+				gdb_sig_halted(connection);
+				log_remove_callback(gdb_log_callback, connection);
+			} else
+				gdb_connection->frontend_state = TARGET_RUNNING;
+			return true;
+		}
+
+		retval = gdb_range_step(ct, start, end);
+		if (retval == ERROR_TARGET_NOT_HALTED)
+			LOG_INFO("target %s was not halted when step was requested", target_name(ct));
+
+		if (retval == ERROR_OK) {
+			retval = target_poll(ct);
+			if (retval != ERROR_OK)
+				LOG_DEBUG("error polling target %s after range step", target_name(ct));
+			gdb_signal_reply(ct, connection);
+			log_remove_callback(gdb_log_callback, connection);
+		} else
+			gdb_connection->frontend_state = TARGET_RUNNING;
+		return true;
+	}
+
 	/* single-step or step-over-breakpoint */
 	if (parse[0] == 's') {
 		gdb_running_type = 's';
@@ -2985,6 +3374,102 @@ static bool gdb_handle_vrun_packet(struct connection *connection, const char *pa
 	return true;
 }
 
+/*
+ * Program the buffered vFlashWrite data below 'limit' and keep the rest.
+ * GDB sends the flash blocks of a load in ascending address order, so
+ * data below the sector that the next packet may still write to is final.
+ * The limit is recorded: a later write below it would program those
+ * sectors a second time without erasing them.
+ */
+static int gdb_vflash_program(struct connection *connection, target_addr_t limit)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct image *image = gdb_connection->vflash_image;
+	struct image settled;
+	struct image *rest;
+	uint32_t written;
+	int retval;
+
+	if (image == NULL)
+		return ERROR_OK;
+
+	image_open(&settled, "", "build");
+	rest = malloc(sizeof(struct image));
+	image_open(rest, "", "build");
+
+	for (unsigned int i = 0; i < image->num_sections; i++) {
+		struct imagesection *section = &image->sections[i];
+		const uint8_t *data = section->private;
+		uint32_t below = 0;
+
+		if (section->base_address < limit)
+			below = MIN(limit - section->base_address, section->size);
+
+		if (below)
+			image_add_section(&settled, section->base_address, below, 0x0, data);
+		if (below < section->size)
+			image_add_section(rest, section->base_address + below,
+					section->size - below, 0x0, data + below);
+	}
+
+	image_close(image);
+	free(image);
+	gdb_connection->vflash_image = rest;
+
+	if (settled.num_sections == 0) {
+		image_close(&settled);
+		return ERROR_OK;
+	}
+
+	if (!gdb_connection->vflash_writing) {
+		target_call_event_callbacks(target,
+				TARGET_EVENT_GDB_FLASH_WRITE_START);
+		gdb_connection->vflash_writing = true;
+	}
+
+	/* No need to erase as GDB always issues a vFlashErase first. */
+	retval = flash_write(target, &settled, &written, false);
+	if (retval == ERROR_OK)
+		gdb_connection->vflash_written += written;
+	if (limit > gdb_connection->vflash_programmed)
+		gdb_connection->vflash_programmed = limit;
+
+	image_close(&settled);
+	return retval;
+}
+
+/* Start of the sector that the write following 'last' may still add to,
+ * everything below it is final. */
+static target_addr_t gdb_vflash_settled_limit(struct target *target, target_addr_t last,
+		target_addr_t next)
+{
+	struct flash_bank *bank;
+
+	if (get_flash_bank_by_addr(target, last, false, &bank) != ERROR_OK || bank == NULL)
+		return 0;
+
+	if (next - bank->base >= bank->size)
+		return bank->base + bank->size;
+
+	uint32_t offset = next - bank->base;
+	uint32_t start = 0;
+	for (unsigned int sect = 0; sect < bank->num_sectors; sect++) {
+		if (bank->sectors[sect].offset > offset)
+			break;
+		start = bank->sectors[sect].offset;
+	}
+	return bank->base + start;
+}
+
+static void gdb_vflash_send_error(struct connection *connection, int retval)
+{
+	if (retval == ERROR_FLASH_DST_OUT_OF_BANK)
+		gdb_put_packet(connection, "E.memtype", 9);
+	else
+		gdb_send_error(connection, EIO);
+}
+
 static int gdb_v_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -3051,6 +3536,10 @@ static int gdb_v_packet(struct connection *connection,
 		 * when flash_write is called multiple times */
 		flash_set_dirty();
 
+		/* a new load starts with erasing, drop what a failed one left */
+		if (gdb_connection->vflash_error != ERROR_OK)
+			gdb_vflash_reset(connection);
+
 		/* perform any target specific operations before the erase */
 		target_call_event_callbacks(target,
 			TARGET_EVENT_GDB_FLASH_ERASE_START);
@@ -3096,6 +3585,20 @@ static int gdb_v_packet(struct connection *connection,
 		}
 		length = packet_size - (parse - packet);
 
+		if (gdb_connection->vflash_error != ERROR_OK) {
+			gdb_vflash_send_error(connection, gdb_connection->vflash_error);
+			return ERROR_OK;
+		}
+
+		if (addr < gdb_connection->vflash_programmed) {
+			LOG_ERROR("vFlashWrite at 0x%8.8lx is below the already programmed "
+					TARGET_ADDR_FMT ", flash blocks must be written in ascending order",
+					addr, gdb_connection->vflash_programmed);
+			gdb_connection->vflash_error = ERROR_FAIL;
+			gdb_vflash_send_error(connection, gdb_connection->vflash_error);
+			return ERROR_OK;
+		}
+
 		/* create a new image if there isn't already one */
 		if (gdb_connection->vflash_image == NULL) {
 			gdb_connection->vflash_image = malloc(sizeof(struct image));
@@ -3110,34 +3613,41 @@ static int gdb_v_packet(struct connection *connection,
 
 		gdb_put_packet(connection, "OK", 2);
 
+		/* program the sectors this packet completed while GDB sends the next one */
+		if (length > 0) {
+			target_addr_t limit = gdb_vflash_settled_limit(target,
+					addr + length - 1, addr + length);
+			retval = gdb_vflash_program(connection, limit);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("flash_write returned %i", retval);
+				gdb_connection->vflash_error = retval;
+			}
+		}
+
 		return ERROR_OK;
 	}
 
 	if (strncmp(packet, "vFlashDone", 10) == 0) {
-		uint32_t written;
+		if (!gdb_connection->vflash_writing) {
+			target_call_event_callbacks(target,
+					TARGET_EVENT_GDB_FLASH_WRITE_START);
+			gdb_connection->vflash_writing = true;
+		}
 
-		/* process the flashing buffer. No need to erase as GDB
-		 * always issues a vFlashErase first. */
-		target_call_event_callbacks(target,
-				TARGET_EVENT_GDB_FLASH_WRITE_START);
-		result = flash_write(target, gdb_connection->vflash_image,
-			&written, false);
-		target_call_event_callbacks(target,
-			TARGET_EVENT_GDB_FLASH_WRITE_END);
+		/* settle whatever partial sectors are still buffered */
+		result = gdb_connection->vflash_error;
+		if (result == ERROR_OK)
+			result = gdb_vflash_program(connection, TARGET_ADDR_MAX);
+		uint32_t written = gdb_connection->vflash_written;
+		gdb_vflash_reset(connection);
 		if (result != ERROR_OK) {
-			if (result == ERROR_FLASH_DST_OUT_OF_BANK)
-				gdb_put_packet(connection, "E.memtype", 9);
-			else
-				gdb_send_error(connection, EIO);
+			gdb_vflash_send_error(connection, result);
 		} else {
-			LOG_DEBUG("wrote %u bytes from vFlash image to flash", (unsigned)written);
+			LOG_DEBUG("wrote %u bytes from vFlash image to flash",
+					(unsigned)written);
 			gdb_put_packet(connection, "OK", 2);
 		}
 
-		image_close(gdb_connection->vflash_image);
-		free(gdb_connection->vflash_image);
-		gdb_connection->vflash_image = NULL;
-
 		return ERROR_OK;
 	}
 
@@ -3227,11 +3737,8 @@ static void gdb_sig_halted(struct connection *connection)
 
 static int gdb_input_inner(struct connection *connection)
 {
-	/* Do not allocate this on the stack */
-	static char gdb_packet_buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
-
 	struct target *target;
-	char const *packet = gdb_packet_buffer;
+	char const *packet;
 	int packet_size;
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
@@ -3251,13 +3758,15 @@ static int gdb_input_inner(struct connection *connection)
 	 * drain the rest of the buffer.
 	 */
 	do {
-		packet_size = GDB_BUFFER_SIZE;
-		retval = gdb_get_packet(connection, gdb_packet_buffer, &packet_size);
+		retval = gdb_get_packet(connection, &packet_size);
 		if (retval != ERROR_OK)
 			return retval;
 
-		/* terminate with zero */
-		gdb_packet_buffer[packet_size] = '\0';
+		/* terminate with zero, a ^C leaves no packet behind */
+		if (gdb_packet_reserve(gdb_con, packet_size) != ERROR_OK)
+			return ERROR_GDB_BUFFER_TOO_SMALL;
+		gdb_con->packet[packet_size] = '\0';
+		packet = gdb_con->packet;
 
 		if (LOG_LEVEL_IS(LOG_LVL_DEBUG)) {
 			if (packet[0] == 'X') {
@@ -3301,6 +3810,7 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_set_register_packet(connection, packet, packet_size);
 					break;
 				case 'm':
+				case 'x':
 					retval = gdb_read_memory_packet(connection, packet, packet_size);
 					break;
 				case 'M':
@@ -3660,6 +4170,26 @@ COMMAND_HANDLER(handle_gdb_report_register_access_error)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_max_packet_size_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int size;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		if (size < GDB_BUFFER_SIZE || size > GDB_MAX_PACKET_SIZE_LIMIT) {
+			command_print(CMD, "packet size must be between %u and %u",
+					GDB_BUFFER_SIZE, GDB_MAX_PACKET_SIZE_LIMIT);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		gdb_max_packet_size = size;
+	}
+
+	command_print(CMD, "%u", gdb_max_packet_size);
+	return ERROR_OK;
+}
+
 /* gdb_breakpoint_override */
 COMMAND_HANDLER(handle_gdb_breakpoint_override_command)
 {
@@ -3788,6 +4318,14 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable reporting register access errors",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_max_packet_size",
+		.handler = handle_gdb_max_packet_size_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or set the largest packet accepted from GDB, "
+			"advertised as PacketSize to new connections",
+		.usage = "[size]"
+	},
 	{
 		.name = "gdb_breakpoint_override",
 		.handler = handle_gdb_breakpoint_override_command,
@@ -30,6 +30,7 @@
 #include <target/target.h>
 #include <target/target_request.h>
 #include <target/openrisc/jsp_server.h>
+#include <helper/time_support.h>
 #include "openocd.h"
 #include "tcl_server.h"
 #include "telnet_server.h"
@@ -42,6 +43,7 @@
 
 #ifndef _WIN32
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 #endif
 
 static struct service *services;
@@ -481,8 +483,15 @@ int server_loop(struct command_context *command_context)
 			tv.tv_usec = 0;
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		} else {
-			/* Every 100ms, can be changed with "poll_period" command */
-			tv.tv_usec = polling_period * 1000;
+			/* Sleep until the next timer callback is due, but at most
+			 * 100ms, which can be changed with "poll_period" command */
+			int64_t timeout_ms = target_timer_next_event() - monotonic_ms();
+			if (timeout_ms < 0)
+				timeout_ms = 0;
+			else if (timeout_ms > polling_period)
+				timeout_ms = polling_period;
+			tv.tv_sec = timeout_ms / 1000;
+			tv.tv_usec = (timeout_ms % 1000) * 1000;
 			/* Only while we're sleeping we'll let others run */
 			openocd_sleep_prelude();
 			kept_alive();
@@ -741,6 +750,73 @@ int connection_write(struct connection *connection, const void *data, int len)
 		return write(connection->fd_out, data, len);
 }
 
+#define CONNECTION_VEC_MAX	8
+
+/**
+ * Write all buffers of @a vec, in order, with as few system calls as
+ * possible; short writes are continued until everything went out.
+ * Returns ERROR_OK, or ERROR_FAIL if the connection failed.
+ */
+int connection_write_vec(struct connection *connection,
+		const struct connection_vec *vec, unsigned int count)
+{
+#ifndef _WIN32
+	struct iovec iov[CONNECTION_VEC_MAX];
+	unsigned int n = 0;
+
+	if (count > CONNECTION_VEC_MAX)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (!vec[i].len)
+			continue;
+		iov[n].iov_base = (void *)vec[i].data;
+		iov[n].iov_len = vec[i].len;
+		n++;
+	}
+
+	struct iovec *cur = iov;
+	while (n) {
+		ssize_t written = writev(connection->fd_out, cur, n);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN) {
+				usleep(1000);
+				continue;
+			}
+			return ERROR_FAIL;
+		}
+
+		/* skip what was written, possibly stopping inside a buffer */
+		while (n && (size_t)written >= cur->iov_len) {
+			written -= cur->iov_len;
+			cur++;
+			n--;
+		}
+		if (n) {
+			cur->iov_base = (char *)cur->iov_base + written;
+			cur->iov_len -= written;
+		}
+	}
+#else
+	for (unsigned int i = 0; i < count; i++) {
+		const char *data = vec[i].data;
+		size_t left = vec[i].len;
+
+		while (left) {
+			int written = connection_write(connection, data, left);
+			if (written <= 0)
+				return ERROR_FAIL;
+			data += written;
+			left -= written;
+		}
+	}
+#endif
+
+	return ERROR_OK;
+}
+
 int connection_read(struct connection *connection, void *data, int len)
 {
 	if (connection->service->type == CONNECTION_TCP)
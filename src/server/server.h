@@ -93,7 +93,15 @@ int server_loop(struct command_context *command_context);
 
 int server_register_commands(struct command_context *context);
 
+/** One buffer of a gathered write, see connection_write_vec(). */
+struct connection_vec {
+	const void *data;
+	size_t len;
+};
+
 int connection_write(struct connection *connection, const void *data, int len);
+int connection_write_vec(struct connection *connection,
+		const struct connection_vec *vec, unsigned int count);
 int connection_read(struct connection *connection, void *data, int len);
 
 /**
@@ -23,6 +23,7 @@
 
 #include "breakpoints.h"
 #include "aarch64.h"
+#include "algorithm.h"
 #include "a64_disassembler.h"
 #include "register.h"
 #include "target_request.h"
@@ -318,18 +319,100 @@ static int aarch64_wait_halt_one(struct target *target)
 	return retval;
 }
 
+#define AARCH64_SMP_MAX_DAPS	8
+
+/*
+ * Flush the DAP queues of all PEs in the SMP group, running each DAP
+ * that carries a debug AP or a CTI of the group exactly once.
+ */
+static int aarch64_smp_run(struct target *target)
+{
+	struct adiv5_dap *daps[AARCH64_SMP_MAX_DAPS];
+	unsigned int num_daps = 0;
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct armv8_common *armv8 = target_to_armv8(curr);
+
+		if (!target_was_examined(curr))
+			continue;
+
+		struct adiv5_dap *used[2] = { armv8->debug_ap->dap, arm_cti_dap(armv8->cti) };
+		for (unsigned int i = 0; i < ARRAY_SIZE(used); i++) {
+			unsigned int j;
+
+			for (j = 0; j < num_daps; j++)
+				if (daps[j] == used[i])
+					break;
+			if (j < num_daps)
+				continue;
+
+			if (num_daps < AARCH64_SMP_MAX_DAPS) {
+				daps[num_daps++] = used[i];
+			} else {
+				int run_retval = dap_run(used[i]);
+				if (retval == ERROR_OK)
+					retval = run_retval;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < num_daps; i++) {
+		int run_retval = dap_run(daps[i]);
+		if (retval == ERROR_OK)
+			retval = run_retval;
+	}
+
+	return retval;
+}
+
+/*
+ * Read PRSR of all examined PEs in the SMP group with a single flush,
+ * the values end up in aarch64->smp_prsr.
+ */
+static int aarch64_smp_read_prsr(struct target *target)
+{
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct armv8_common *armv8 = target_to_armv8(curr);
+
+		if (!target_was_examined(curr))
+			continue;
+
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_PRSR, &target_to_aarch64(curr)->smp_prsr);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	int run_retval = aarch64_smp_run(target);
+	if (retval == ERROR_OK)
+		retval = run_retval;
+
+	return retval;
+}
+
 static int aarch64_prepare_halt_smp(struct target *target, bool exc_target, struct target **p_first)
 {
 	int retval = ERROR_OK;
-	struct target_list *head = target->head;
+	struct target_list *head;
 	struct target *first = NULL;
+	unsigned int selected = 0;
 
 	LOG_DEBUG("target %s exc %i", target_name(target), exc_target);
 
-	while (head != NULL) {
+	/* queue DSCR and CTI gate reads for all PEs that need halting */
+	foreach_smp_target(head, target->head) {
 		struct target *curr = head->target;
-		struct armv8_common *armv8 = target_to_armv8(curr);
-		head = head->next;
+		struct aarch64_common *aarch64 = target_to_aarch64(curr);
+		struct armv8_common *armv8 = &aarch64->armv8_common;
+
+		aarch64->smp_selected = false;
 
 		if (exc_target && curr == target)
 			continue;
@@ -338,20 +421,56 @@ static int aarch64_prepare_halt_smp(struct target *target, bool exc_target, stru
 		if (curr->state != TARGET_RUNNING)
 			continue;
 
-		/* HACK: mark this target as prepared for halting */
-		curr->debug_reason = DBG_REASON_DBGRQ;
+		aarch64->smp_selected = true;
+		selected++;
 
-		/* open the gate for channel 0 to let HALT requests pass to the CTM */
-		retval = arm_cti_ungate_channel(armv8->cti, 0);
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &aarch64->smp_dscr);
 		if (retval == ERROR_OK)
-			retval = aarch64_set_dscr_bits(curr, DSCR_HDE, DSCR_HDE);
+			retval = arm_cti_queue_read_reg(armv8->cti, CTI_GATE, &aarch64->smp_cti_gate);
 		if (retval != ERROR_OK)
 			break;
+	}
 
-		LOG_DEBUG("target %s prepared", target_name(curr));
+	if (selected) {
+		int run_retval = aarch64_smp_run(target);
+		if (retval == ERROR_OK)
+			retval = run_retval;
+	}
 
-		if (first == NULL)
-			first = curr;
+	/*
+	 * open the gate for channel 0 to let HALT requests pass to the CTM
+	 * and allow Halting Debug Mode, all PEs in one flush
+	 */
+	if (retval == ERROR_OK && selected) {
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
+			struct aarch64_common *aarch64 = target_to_aarch64(curr);
+			struct armv8_common *armv8 = &aarch64->armv8_common;
+
+			if (!aarch64->smp_selected)
+				continue;
+
+			/* HACK: mark this target as prepared for halting */
+			curr->debug_reason = DBG_REASON_DBGRQ;
+
+			retval = arm_cti_queue_write_reg(armv8->cti, CTI_GATE,
+					aarch64->smp_cti_gate | CTI_CHNL(0));
+			if (retval == ERROR_OK)
+				retval = mem_ap_write_u32(armv8->debug_ap,
+						armv8->debug_base + CPUV8_DBG_DSCR, aarch64->smp_dscr | DSCR_HDE);
+			if (retval != ERROR_OK)
+				break;
+
+			LOG_DEBUG("target %s prepared", target_name(curr));
+
+			if (first == NULL)
+				first = curr;
+		}
+
+		int run_retval = aarch64_smp_run(target);
+		if (retval == ERROR_OK)
+			retval = run_retval;
 	}
 
 	if (p_first) {
@@ -404,9 +523,16 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 	if (exc_target && next == target)
 		return retval;
 
-	/* halt the target PE */
-	if (retval == ERROR_OK)
-		retval = aarch64_halt_one(next, HALT_LAZY);
+	/*
+	 * halt the target PE, the event on channel 0 propagates through the
+	 * CTM to all PEs that were prepared above
+	 */
+	if (retval == ERROR_OK) {
+		if (target_to_aarch64(next)->smp_selected)
+			retval = arm_cti_pulse_channel(target_to_armv8(next)->cti, 0);
+		else
+			retval = aarch64_halt_one(next, HALT_LAZY);
+	}
 
 	if (retval != ERROR_OK)
 		return retval;
@@ -414,26 +540,26 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 	/* wait for all PEs to halt */
 	int64_t then = timeval_ms();
 	for (;;) {
-		bool all_halted = true;
+		struct target *pending = NULL;
 		struct target_list *head;
-		struct target *curr;
 
-		foreach_smp_target(head, target->head) {
-			int halted;
+		retval = aarch64_smp_read_prsr(target);
+		if (retval != ERROR_OK)
+			break;
 
-			curr = head->target;
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
 
 			if (!target_was_examined(curr))
 				continue;
 
-			retval = aarch64_check_state_one(curr, PRSR_HALT, PRSR_HALT, &halted, NULL);
-			if (retval != ERROR_OK || !halted) {
-				all_halted = false;
+			if (!(target_to_aarch64(curr)->smp_prsr & PRSR_HALT)) {
+				pending = curr;
 				break;
 			}
 		}
 
-		if (all_halted)
+		if (pending == NULL)
 			break;
 
 		if (timeval_ms() > then + 1000) {
@@ -448,7 +574,7 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 		 * cluster explicitly. So if we find that a core has not halted
 		 * yet, we trigger an explicit halt for the second cluster.
 		 */
-		retval = aarch64_halt_one(curr, HALT_LAZY);
+		retval = aarch64_halt_one(pending, HALT_LAZY);
 		if (retval != ERROR_OK)
 			break;
 	}
@@ -502,14 +628,38 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
  * Aarch64 Run control
  */
 
+static int aarch64_poll_queue(struct target *target)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+
+	int retval = mem_ap_read_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_PRSR, &aarch64->prsr_queued);
+	if (retval != ERROR_OK)
+		return retval;
+
+	aarch64->prsr_is_queued = true;
+	aarch64->prsr_queued_at = armv8->debug_ap->dap->run_count;
+	return ERROR_OK;
+}
+
 static int aarch64_poll(struct target *target)
 {
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
 	enum target_state prev_target_state;
-	int retval = ERROR_OK;
+	int retval = ERROR_FAIL;
 	int halted;
 
-	retval = aarch64_check_state_one(target,
-				PRSR_HALT, PRSR_HALT, &halted, NULL);
+	/* use the PRSR read shared with other cores on this DAP, if any */
+	if (aarch64->prsr_is_queued && target->poll_due) {
+		retval = dap_run_queued(armv8->debug_ap->dap, aarch64->prsr_queued_at);
+		halted = (aarch64->prsr_queued & PRSR_HALT) == PRSR_HALT;
+	}
+	aarch64->prsr_is_queued = false;
+	if (retval != ERROR_OK)
+		retval = aarch64_check_state_one(target,
+					PRSR_HALT, PRSR_HALT, &halted, NULL);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -724,104 +874,204 @@ static int aarch64_restart_one(struct target *target, enum restart_mode mode)
 }
 
 /*
- * prepare all but the current target for restart
+ * prepare all halted PEs of the SMP group for restart, optionally
+ * excluding the current target. The CTI and DSCR updates of all PEs
+ * are batched so that each step costs a single flush per DAP.
  */
-static int aarch64_prep_restart_smp(struct target *target, int handle_breakpoints, struct target **p_first)
+static int aarch64_prepare_restart_smp(struct target *target, bool exc_target, struct target **p_first)
 {
 	int retval = ERROR_OK;
 	struct target_list *head;
 	struct target *first = NULL;
-	uint64_t address;
+	unsigned int selected = 0;
 
+	/* acknowledge pending CTI halt events and fetch DSCR and CTI gates */
 	foreach_smp_target(head, target->head) {
 		struct target *curr = head->target;
+		struct aarch64_common *aarch64 = target_to_aarch64(curr);
+		struct armv8_common *armv8 = &aarch64->armv8_common;
 
-		/* skip calling target */
-		if (curr == target)
+		aarch64->smp_selected = false;
+
+		if (exc_target && curr == target)
 			continue;
 		if (!target_was_examined(curr))
 			continue;
 		if (curr->state != TARGET_HALTED)
 			continue;
 
-		/*  resume at current address, not in step mode */
-		retval = aarch64_restore_one(curr, 1, &address, handle_breakpoints, 0);
+		aarch64->smp_selected = true;
+		selected++;
+
+		retval = arm_cti_queue_write_reg(armv8->cti, CTI_INACK, CTI_TRIG(HALT));
 		if (retval == ERROR_OK)
-			retval = aarch64_prepare_restart_one(curr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("failed to restore target %s", target_name(curr));
+			retval = arm_cti_queue_read_reg(armv8->cti, CTI_GATE, &aarch64->smp_cti_gate);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, &aarch64->smp_dscr);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	if (p_first)
+		*p_first = NULL;
+
+	if (!selected)
+		return retval;
+
+	int run_retval = aarch64_smp_run(target);
+	if (retval == ERROR_OK)
+		retval = run_retval;
+	if (retval != ERROR_OK)
+		return retval;
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct aarch64_common *aarch64 = target_to_aarch64(curr);
+
+		if (!aarch64->smp_selected)
+			continue;
+
+		if ((aarch64->smp_dscr & DSCR_ITE) == 0)
+			LOG_ERROR("%s: DSCR.ITE must be set before leaving debug!", target_name(curr));
+		if ((aarch64->smp_dscr & DSCR_ERR) != 0)
+			LOG_ERROR("%s: DSCR.ERR must be cleared before leaving debug!", target_name(curr));
+	}
+
+	/* wait until the halt trigger outputs are deasserted */
+	int64_t then = timeval_ms();
+	for (;;) {
+		struct target *pending = NULL;
+
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
+			struct aarch64_common *aarch64 = target_to_aarch64(curr);
+
+			if (!aarch64->smp_selected)
+				continue;
+
+			retval = arm_cti_queue_read_reg(aarch64->armv8_common.cti,
+					CTI_TROUT_STATUS, &aarch64->smp_cti_trout);
+			if (retval != ERROR_OK)
+				break;
+		}
+
+		run_retval = aarch64_smp_run(target);
+		if (retval == ERROR_OK)
+			retval = run_retval;
+		if (retval != ERROR_OK)
+			return retval;
+
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
+			struct aarch64_common *aarch64 = target_to_aarch64(curr);
+
+			if (aarch64->smp_selected && (aarch64->smp_cti_trout & CTI_TRIG(HALT))) {
+				pending = curr;
+				break;
+			}
+		}
+
+		if (pending == NULL)
 			break;
+
+		if (timeval_ms() > then + 1000) {
+			LOG_ERROR("timeout waiting for target %s", target_name(pending));
+			return ERROR_TARGET_TIMEOUT;
 		}
+	}
+
+	/*
+	 * open the CTI gate for channel 1 so that the restart events
+	 * get passed along to all PEs. Also close gate for channel 0
+	 * to isolate the PE from halt events. Make sure that DSCR.HDE
+	 * is set and clear sticky bits in PRSR, SDR is now 0.
+	 */
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct aarch64_common *aarch64 = target_to_aarch64(curr);
+		struct armv8_common *armv8 = &aarch64->armv8_common;
+
+		if (!aarch64->smp_selected)
+			continue;
+
+		retval = arm_cti_queue_write_reg(armv8->cti, CTI_GATE,
+				(aarch64->smp_cti_gate | CTI_CHNL(1)) & ~CTI_CHNL(0));
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, aarch64->smp_dscr | DSCR_HDE);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_PRSR, &aarch64->smp_prsr);
+		if (retval != ERROR_OK)
+			break;
+
 		/* remember the first valid target in the group */
 		if (first == NULL)
 			first = curr;
 	}
 
+	run_retval = aarch64_smp_run(target);
+	if (retval == ERROR_OK)
+		retval = run_retval;
+
 	if (p_first)
 		*p_first = first;
 
 	return retval;
 }
 
-
-static int aarch64_step_restart_smp(struct target *target)
+/*
+ * wait for the PEs of the SMP group to leave debug state after a restart
+ * event, optionally excluding the current target
+ */
+static int aarch64_wait_restart_smp(struct target *target, bool exc_target)
 {
-	int retval = ERROR_OK;
-	struct target_list *head;
-	struct target *first = NULL;
-
-	LOG_DEBUG("%s", target_name(target));
-
-	retval = aarch64_prep_restart_smp(target, 0, &first);
-	if (retval != ERROR_OK)
-		return retval;
-
-	if (first != NULL)
-		retval = aarch64_do_restart_one(first, RESTART_LAZY);
-	if (retval != ERROR_OK) {
-		LOG_DEBUG("error restarting target %s", target_name(first));
-		return retval;
-	}
+	int retval;
 
 	int64_t then = timeval_ms();
 	for (;;) {
-		struct target *curr = target;
-		bool all_resumed = true;
+		struct target *pending = NULL;
+		struct target_list *head;
 
-		foreach_smp_target(head, target->head) {
-			uint32_t prsr;
-			int resumed;
+		retval = aarch64_smp_read_prsr(target);
+		if (retval != ERROR_OK)
+			break;
 
-			curr = head->target;
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
+			uint32_t prsr = target_to_aarch64(curr)->smp_prsr;
 
-			if (curr == target)
+			if (exc_target && curr == target)
 				continue;
-
 			if (!target_was_examined(curr))
 				continue;
 
-			retval = aarch64_check_state_one(curr,
-					PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-			if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
-				all_resumed = false;
+			/*
+			 * if PRSR.SDR is set now, the target did restart, even
+			 * if it's now already halted again (e.g. due to breakpoint)
+			 */
+			if (!(prsr & PRSR_SDR) && (prsr & PRSR_HALT)) {
+				pending = curr;
 				break;
 			}
 
-			if (curr->state != TARGET_RUNNING) {
+			if (curr != target && curr->state != TARGET_RUNNING) {
 				curr->state = TARGET_RUNNING;
 				curr->debug_reason = DBG_REASON_NOTHALTED;
 				target_call_event_callbacks(curr, TARGET_EVENT_RESUMED);
 			}
 		}
 
-		if (all_resumed)
+		if (pending == NULL)
 			break;
 
 		if (timeval_ms() > then + 1000) {
-			LOG_ERROR("%s: timeout waiting for target resume", __func__);
+			LOG_ERROR("%s: timeout waiting for target %s to resume", __func__, target_name(pending));
 			retval = ERROR_TARGET_TIMEOUT;
 			break;
 		}
+
 		/*
 		 * HACK: on Hi6220 there are 8 cores organized in 2 clusters
 		 * and it looks like the CTI's are not connected by a common
@@ -829,97 +1079,115 @@ static int aarch64_step_restart_smp(struct target *target)
 		 * cluster explicitly. So if we find that a core has not halted
 		 * yet, we trigger an explicit resume for the second cluster.
 		 */
-		retval = aarch64_do_restart_one(curr, RESTART_LAZY);
+		retval = aarch64_do_restart_one(pending, RESTART_LAZY);
 		if (retval != ERROR_OK)
 			break;
-}
+	}
 
 	return retval;
 }
 
-static int aarch64_resume(struct target *target, int current,
-	target_addr_t address, int handle_breakpoints, int debug_execution)
+/*
+ * restore the register context of all but the current target
+ */
+static int aarch64_restore_smp(struct target *target, int handle_breakpoints)
 {
-	int retval = 0;
-	uint64_t addr = address;
+	int retval = ERROR_OK;
+	struct target_list *head;
+	uint64_t address;
 
-	struct armv8_common *armv8 = target_to_armv8(target);
-	armv8->last_run_control_op = ARMV8_RUNCONTROL_RESUME;
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
 
-	if (target->state != TARGET_HALTED)
-		return ERROR_TARGET_NOT_HALTED;
+		/* skip calling target */
+		if (curr == target)
+			continue;
+		if (!target_was_examined(curr))
+			continue;
+		if (curr->state != TARGET_HALTED)
+			continue;
 
-	/*
-	 * If this target is part of a SMP group, prepare the others
-	 * targets for resuming. This involves restoring the complete
-	 * target register context and setting up CTI gates to accept
-	 * resume events from the trigger matrix.
-	 */
-	if (target->smp) {
-		retval = aarch64_prep_restart_smp(target, handle_breakpoints, NULL);
-		if (retval != ERROR_OK)
-			return retval;
+		/*  resume at current address, not in step mode */
+		retval = aarch64_restore_one(curr, 1, &address, handle_breakpoints, 0);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("failed to restore target %s", target_name(curr));
+			break;
+		}
 	}
 
-	/* all targets prepared, restore and restart the current target */
-	retval = aarch64_restore_one(target, current, &addr, handle_breakpoints,
-				 debug_execution);
+	return retval;
+}
+
+/*
+ * prepare all but the current target for restart
+ */
+static int aarch64_prep_restart_smp(struct target *target, int handle_breakpoints, struct target **p_first)
+{
+	int retval;
+
+	retval = aarch64_restore_smp(target, handle_breakpoints);
 	if (retval == ERROR_OK)
-		retval = aarch64_restart_one(target, RESTART_SYNC);
-	if (retval != ERROR_OK)
-		return retval;
+		retval = aarch64_prepare_restart_smp(target, true, p_first);
 
-	if (target->smp) {
-		int64_t then = timeval_ms();
-		for (;;) {
-			struct target *curr = target;
-			struct target_list *head;
-			bool all_resumed = true;
-
-			foreach_smp_target(head, target->head) {
-				uint32_t prsr;
-				int resumed;
-
-				curr = head->target;
-				if (curr == target)
-					continue;
-				if (!target_was_examined(curr))
-					continue;
-
-				retval = aarch64_check_state_one(curr,
-						PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-				if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
-					all_resumed = false;
-					break;
-				}
+	return retval;
+}
 
-				if (curr->state != TARGET_RUNNING) {
-					curr->state = TARGET_RUNNING;
-					curr->debug_reason = DBG_REASON_NOTHALTED;
-					target_call_event_callbacks(curr, TARGET_EVENT_RESUMED);
-				}
-			}
 
-			if (all_resumed)
-				break;
+static int aarch64_step_restart_smp(struct target *target)
+{
+	int retval = ERROR_OK;
+	struct target *first = NULL;
 
-			if (timeval_ms() > then + 1000) {
-				LOG_ERROR("%s: timeout waiting for target %s to resume", __func__, target_name(curr));
-				retval = ERROR_TARGET_TIMEOUT;
-				break;
-			}
+	LOG_DEBUG("%s", target_name(target));
 
-			/*
-			 * HACK: on Hi6220 there are 8 cores organized in 2 clusters
-			 * and it looks like the CTI's are not connected by a common
-			 * trigger matrix. It seems that we need to halt one core in each
-			 * cluster explicitly. So if we find that a core has not halted
-			 * yet, we trigger an explicit resume for the second cluster.
-			 */
-			retval = aarch64_do_restart_one(curr, RESTART_LAZY);
-			if (retval != ERROR_OK)
-				break;
-		}
+	retval = aarch64_prep_restart_smp(target, 0, &first);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (first != NULL)
+		retval = aarch64_do_restart_one(first, RESTART_LAZY);
+	if (retval != ERROR_OK) {
+		LOG_DEBUG("error restarting target %s", target_name(first));
+		return retval;
+	}
+
+	return aarch64_wait_restart_smp(target, true);
+}
+
+static int aarch64_resume(struct target *target, int current,
+	target_addr_t address, int handle_breakpoints, int debug_execution)
+{
+	int retval = 0;
+	uint64_t addr = address;
+
+	struct armv8_common *armv8 = target_to_armv8(target);
+	armv8->last_run_control_op = ARMV8_RUNCONTROL_RESUME;
+
+	if (target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	/*
+	 * If this target is part of a SMP group, restore the complete
+	 * register context of all targets first, then set up the CTI gates
+	 * of the whole group to accept resume events from the trigger matrix
+	 * and restart everything with a single channel 1 event.
+	 */
+	if (target->smp) {
+		retval = aarch64_restore_smp(target, handle_breakpoints);
+		if (retval == ERROR_OK)
+			retval = aarch64_restore_one(target, current, &addr, handle_breakpoints,
+					debug_execution);
+		if (retval == ERROR_OK)
+			retval = aarch64_prepare_restart_smp(target, false, NULL);
+		if (retval == ERROR_OK)
+			retval = arm_cti_pulse_channel(armv8->cti, 1);
+		if (retval == ERROR_OK)
+			retval = aarch64_wait_restart_smp(target, false);
+	} else {
+		retval = aarch64_restore_one(target, current, &addr, handle_breakpoints,
+					 debug_execution);
+		if (retval == ERROR_OK)
+			retval = aarch64_restart_one(target, RESTART_SYNC);
 	}
 
 	if (retval != ERROR_OK)
@@ -1970,245 +2238,731 @@ static int aarch64_read_cpu_memory_slow(struct target *target,
 		else
 			target_buffer_set_u32(target, buffer, data);
 
-		/* Advance */
-		buffer += size;
-		--count;
-	}
+		/* Advance */
+		buffer += size;
+		--count;
+	}
+
+	return ERROR_OK;
+}
+
+static int aarch64_read_cpu_memory_fast(struct target *target,
+	uint32_t count, uint8_t *buffer, uint32_t *dscr)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_dpm *dpm = &armv8->dpm;
+	struct arm *arm = &armv8->arm;
+	int retval;
+	uint32_t value;
+
+	/* Mark X1 as dirty */
+	armv8_reg_current(arm, 1)->dirty = true;
+
+	if (arm->core_state == ARM_STATE_AARCH64) {
+		/* Step 1.d - Dummy operation to ensure EDSCR.Txfull == 1 */
+		retval = dpm->instr_execute(dpm, ARMV8_MSR_GP(SYSTEM_DBG_DBGDTR_EL0, 0));
+	} else {
+		/* Step 1.d - Dummy operation to ensure EDSCR.Txfull == 1 */
+		retval = dpm->instr_execute(dpm, ARMV4_5_MCR(14, 0, 0, 0, 5, 0));
+	}
+
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Step 1.e - Change DCC to memory mode */
+	*dscr |= DSCR_MA;
+	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Step 1.f - read DBGDTRTX and discard the value */
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_DTRTX, &value);
+	if (retval != ERROR_OK)
+		return retval;
+
+	count--;
+	/* Read the data - Each read of the DTRTX register causes the instruction to be reissued
+	 * Abort flags are sticky, so can be read at end of transactions
+	 *
+	 * This data is read in aligned to 32 bit boundary.
+	 */
+
+	if (count) {
+		/* Step 2.a - Loop n-1 times, each read of DBGDTRTX reads the data from [X0] and
+		 * increments X0 by 4. */
+		retval = mem_ap_read_buf_noincr(armv8->debug_ap, buffer, 4, count,
+									armv8->debug_base + CPUV8_DBG_DTRTX);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	/* Step 3.a - set DTR access mode back to Normal mode	*/
+	*dscr &= ~DSCR_MA;
+	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Step 3.b - read DBGDTRTX for the final value */
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_DTRTX, &value);
+	if (retval != ERROR_OK)
+		return retval;
+
+	target_buffer_set_u32(target, buffer + count * 4, value);
+	return retval;
+}
+
+static int aarch64_read_cpu_memory(struct target *target,
+	target_addr_t address, uint32_t size,
+	uint32_t count, uint8_t *buffer)
+{
+	/* read memory through APB-AP */
+	int retval = ERROR_COMMAND_SYNTAX_ERROR;
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_dpm *dpm = &armv8->dpm;
+	struct arm *arm = &armv8->arm;
+	uint32_t dscr;
+
+	LOG_DEBUG("Reading CPU memory address 0x%016" PRIx64 " size %" PRIu32 " count %" PRIu32,
+			address, size, count);
+
+	if (target->state != TARGET_HALTED) {
+		LOG_WARNING("target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	/* Mark register X0 as dirty, as it will be used
+	 * for transferring the data.
+	 * It will be restored automatically when exiting
+	 * debug mode
+	 */
+	armv8_reg_current(arm, 0)->dirty = true;
+
+	/* Read DSCR */
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* This algorithm comes from DDI0487A.g, chapter J9.1 */
+
+	/* Set Normal access mode  */
+	dscr &= ~DSCR_MA;
+	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_DSCR, dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (arm->core_state == ARM_STATE_AARCH64) {
+		/* Write X0 with value 'address' using write procedure */
+		/* Step 1.a+b - Write the address for read access into DBGDTR_EL0 */
+		/* Step 1.c   - Copy value from DTR to R0 using instruction mrs DBGDTR_EL0, x0 */
+		retval = dpm->instr_write_data_dcc_64(dpm,
+				ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0), address);
+	} else {
+		/* Write R0 with value 'address' using write procedure */
+		/* Step 1.a+b - Write the address for read access into DBGDTRRXint */
+		/* Step 1.c   - Copy value from DTR to R0 using instruction mrc DBGDTRTXint, r0 */
+		retval = dpm->instr_write_data_dcc(dpm,
+				ARMV4_5_MRC(14, 0, 0, 0, 5, 0), address);
+	}
+
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (size == 4 && (address % 4) == 0)
+		retval = aarch64_read_cpu_memory_fast(target, count, buffer, &dscr);
+	else
+		retval = aarch64_read_cpu_memory_slow(target, size, count, buffer, &dscr);
+
+	if (dscr & DSCR_MA) {
+		dscr &= ~DSCR_MA;
+		mem_ap_write_atomic_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, dscr);
+	}
+
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Check for sticky abort flags in the DSCR */
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	dpm->dscr = dscr;
+
+	if (dscr & (DSCR_ERR | DSCR_SYS_ERROR_PEND)) {
+		/* Abort occurred - clear it and exit */
+		LOG_ERROR("abort occurred - dscr = 0x%08" PRIx32, dscr);
+		armv8_dpm_handle_exception(dpm, true);
+		return ERROR_FAIL;
+	}
+
+	/* Done */
+	return ERROR_OK;
+}
+
+static int aarch64_read_phys_memory(struct target *target,
+	target_addr_t address, uint32_t size,
+	uint32_t count, uint8_t *buffer)
+{
+	int retval = ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (count && buffer) {
+		/* read memory through APB-AP */
+		retval = aarch64_mmu_modify(target, 0);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = aarch64_read_cpu_memory(target, address, size, count, buffer);
+	}
+	return retval;
+}
+
+static int aarch64_read_memory(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, uint8_t *buffer)
+{
+	int mmu_enabled = 0;
+	int retval;
+
+	/* determine if MMU was enabled on target stop */
+	retval = aarch64_mmu(target, &mmu_enabled);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (mmu_enabled) {
+		/* enable MMU as we could have disabled it for phys access */
+		retval = aarch64_mmu_modify(target, 1);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return aarch64_read_cpu_memory(target, address, size, count, buffer);
+}
+
+static int aarch64_write_phys_memory(struct target *target,
+	target_addr_t address, uint32_t size,
+	uint32_t count, const uint8_t *buffer)
+{
+	int retval = ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (count && buffer) {
+		/* write memory through APB-AP */
+		retval = aarch64_mmu_modify(target, 0);
+		if (retval != ERROR_OK)
+			return retval;
+		return aarch64_write_cpu_memory(target, address, size, count, buffer);
+	}
+
+	return retval;
+}
+
+static int aarch64_write_memory(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, const uint8_t *buffer)
+{
+	int mmu_enabled = 0;
+	int retval;
+
+	/* determine if MMU was enabled on target stop */
+	retval = aarch64_mmu(target, &mmu_enabled);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (mmu_enabled) {
+		/* enable MMU as we could have disabled it for phys access */
+		retval = aarch64_mmu_modify(target, 1);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return aarch64_write_cpu_memory(target, address, size, count, buffer);
+}
+
+/*
+ * Run a piece of A64 code on this PE only. The other members of an SMP
+ * group stay halted: the restart event is not propagated through the CTM.
+ * The algorithm terminates either on the exit_point hardware breakpoint
+ * or on a HLT instruction.
+ */
+static int aarch64_run_algorithm(struct target *target,
+	int num_mem_params, struct mem_param *mem_params,
+	int num_reg_params, struct reg_param *reg_params,
+	target_addr_t entry_point, target_addr_t exit_point,
+	int timeout_ms, void *arch_info)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm *arm = &armv8->arm;
+	struct arm_algorithm *arm_algorithm_info = arch_info;
+	uint64_t context[ARMV8_xPSR + 1];
+	uint64_t address = entry_point;
+	int retval, retvaltemp, i;
+
+	LOG_DEBUG("Running algorithm");
+
+	if (arm_algorithm_info->common_magic != ARM_COMMON_MAGIC) {
+		LOG_ERROR("current target isn't an ARMV8 target");
+		return ERROR_TARGET_INVALID;
+	}
+
+	if (target->state != TARGET_HALTED) {
+		LOG_WARNING("target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if (arm->core_state != ARM_STATE_AARCH64
+			|| arm_algorithm_info->core_state != ARM_STATE_AARCH64) {
+		LOG_ERROR("BUG: can't execute algorithms when not in AArch64 state");
+		return ERROR_TARGET_INVALID;
+	}
+
+	/* save x0..x30, sp, pc and cpsr; they'll be restored later */
+	for (i = ARMV8_R0; i <= ARMV8_xPSR; i++) {
+		struct reg *r = arm->core_cache->reg_list + i;
+
+		if (!r->valid) {
+			retval = r->type->get(r);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		context[i] = buf_get_u64(r->value, 0, r->size);
+	}
+
+	for (i = 0; i < num_mem_params; i++) {
+		if (mem_params[i].direction == PARAM_IN)
+			continue;
+		retval = target_write_buffer(target, mem_params[i].address,
+				mem_params[i].size, mem_params[i].value);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (i = 0; i < num_reg_params; i++) {
+		if (reg_params[i].direction == PARAM_IN)
+			continue;
+
+		struct reg *reg = register_get_by_name(arm->core_cache, reg_params[i].reg_name, false);
+		if (!reg) {
+			LOG_ERROR("BUG: register '%s' not found", reg_params[i].reg_name);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+
+		if (reg->size != reg_params[i].size) {
+			LOG_ERROR("BUG: register '%s' size doesn't match reg_params[i].size",
+				reg_params[i].reg_name);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+
+		retval = reg->type->set(reg, reg_params[i].value);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (exit_point) {
+		retval = breakpoint_add(target, exit_point, 4, BKPT_HARD);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("can't add HW breakpoint to terminate algorithm");
+			return ERROR_TARGET_FAILURE;
+		}
+	}
+
+	/* keep interrupts away from the algorithm, EDSCR.INTdis is put back
+	 * as it was on every way out */
+	uint32_t dscr;
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval != ERROR_OK) {
+		if (exit_point)
+			breakpoint_remove(target, exit_point);
+		return retval;
+	}
+	uint32_t intdis = dscr & (0x3 << 22);
+
+	retval = aarch64_set_dscr_bits(target, 0x3 << 22, 0x3 << 22);
+	if (retval == ERROR_OK)
+		retval = aarch64_restore_one(target, 0, &address, 0, 1);
+	if (retval == ERROR_OK)
+		retval = aarch64_prepare_restart_one(target);
+	/* restart this PE only */
+	if (retval == ERROR_OK)
+		retval = arm_cti_gate_channel(armv8->cti, 1);
+	if (retval == ERROR_OK)
+		retval = aarch64_do_restart_one(target, RESTART_SYNC);
+	if (retval != ERROR_OK)
+		goto out;
+
+	target->state = TARGET_DEBUG_RUNNING;
+
+	int64_t then = timeval_ms();
+	for (;;) {
+		int halted;
+
+		retval = aarch64_check_state_one(target, PRSR_HALT, PRSR_HALT, &halted, NULL);
+		if (retval != ERROR_OK)
+			goto out;
+		if (halted)
+			break;
+
+		if (timeval_ms() > then + timeout_ms) {
+			LOG_ERROR("timeout waiting for algorithm to complete, trying to halt target");
+			retval = aarch64_halt_one(target, HALT_SYNC);
+			if (retval != ERROR_OK) {
+				target->state = TARGET_RUNNING;
+				goto out;
+			}
+			retval = ERROR_TARGET_TIMEOUT;
+			break;
+		}
+
+		keep_alive();
+	}
+
+	target->state = TARGET_HALTED;
+	retvaltemp = aarch64_debug_entry(target);
+	if (retval == ERROR_OK)
+		retval = retvaltemp;
+	if (retval != ERROR_OK)
+		goto out;
+
+	if (exit_point) {
+		uint64_t pc = buf_get_u64(arm->pc->value, 0, 64);
+		if (pc != exit_point) {
+			LOG_ERROR("algorithm exited at 0x%" PRIx64 " instead of 0x%" PRIx64,
+				pc, (uint64_t)exit_point);
+			retval = ERROR_TARGET_TIMEOUT;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < num_mem_params; i++) {
+		if (mem_params[i].direction == PARAM_OUT)
+			continue;
+		retvaltemp = target_read_buffer(target, mem_params[i].address,
+				mem_params[i].size, mem_params[i].value);
+		if (retvaltemp != ERROR_OK)
+			retval = retvaltemp;
+	}
+
+	for (i = 0; i < num_reg_params; i++) {
+		if (reg_params[i].direction == PARAM_OUT)
+			continue;
+
+		struct reg *reg = register_get_by_name(arm->core_cache, reg_params[i].reg_name, false);
+		if (!reg || reg->size != reg_params[i].size) {
+			LOG_ERROR("BUG: register '%s' not found or size mismatch",
+				reg_params[i].reg_name);
+			retval = ERROR_COMMAND_SYNTAX_ERROR;
+			continue;
+		}
+
+		if (!reg->valid) {
+			retvaltemp = reg->type->get(reg);
+			if (retvaltemp != ERROR_OK) {
+				retval = retvaltemp;
+				continue;
+			}
+		}
+		buf_set_u64(reg_params[i].value, 0, reg->size, buf_get_u64(reg->value, 0, reg->size));
+	}
+
+out:
+	if (exit_point)
+		breakpoint_remove(target, exit_point);
+
+	retvaltemp = aarch64_set_dscr_bits(target, 0x3 << 22, intdis);
+	if (retval == ERROR_OK)
+		retval = retvaltemp;
+
+	if (target->state != TARGET_HALTED)
+		return retval;
+
+	/* restore everything we saved before; write-back happens on resume */
+	for (i = ARMV8_R0; i <= ARMV8_xPSR; i++) {
+		struct reg *r = arm->core_cache->reg_list + i;
+
+		if (r->valid && buf_get_u64(r->value, 0, r->size) == context[i])
+			continue;
+
+		LOG_DEBUG("restoring register %s with value 0x%" PRIx64, r->name, context[i]);
+		if (i == ARMV8_xPSR)
+			armv8_set_cpsr(arm, context[i]);
+		else
+			buf_set_u64(r->value, 0, r->size, context[i]);
+		r->valid = true;
+		r->dirty = true;
+	}
+
+	return retval;
+}
+
+/* make freshly downloaded algorithm code visible to instruction fetch */
+static int aarch64_sync_algorithm_code(struct target *target,
+	struct working_area *area, uint32_t size)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	int retval;
+
+	retval = armv8_cache_d_inner_flush_virt(armv8, area->address, size);
+	if (retval == ERROR_OK)
+		retval = armv8_cache_i_inner_inval_virt(armv8, area->address, size);
+
+	return retval;
+}
+
+static int aarch64_checksum_memory(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum)
+{
+	struct working_area *crc_algorithm;
+	struct arm_algorithm arm_algo;
+	struct reg_param reg_params[2];
+	int retval;
+
+	static const uint8_t aarch64_crc_code[] = {
+#include "../../contrib/loaders/checksum/armv8_crc.inc"
+	};
+
+	/* the algorithm expects its 1 KiB lookup table right behind the code;
+	 * it is written by the host so that the working area backup sees it */
+	uint8_t crc_image[sizeof(aarch64_crc_code) + 1024];
+	memcpy(crc_image, aarch64_crc_code, sizeof(aarch64_crc_code));
+	for (unsigned int i = 0; i < 256; i++) {
+		uint32_t c = i << 24;
+		for (unsigned int j = 0; j < 8; j++)
+			c = (c & 0x80000000) ? (c << 1) ^ 0x04c11db7 : c << 1;
+		target_buffer_set_u32(target, crc_image + sizeof(aarch64_crc_code) + 4 * i, c);
+	}
+
+	/* kept resident, block-wise callers like mem_snapshot run it many times */
+	retval = target_alloc_resident_working_area(target, "aarch64_crc",
+			crc_image, sizeof(crc_image), &crc_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = aarch64_sync_algorithm_code(target, crc_algorithm,
+			sizeof(aarch64_crc_code));
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_ANY;
+	arm_algo.core_state = ARM_STATE_AARCH64;
+
+	init_reg_param(&reg_params[0], "x0", 64, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "x1", 64, PARAM_OUT);
+
+	buf_set_u64(reg_params[0].value, 0, 64, address);
+	buf_set_u64(reg_params[1].value, 0, 64, count);
+
+	int timeout = 20000 * (1 + (count / (1024 * 1024)));
+
+	retval = target_run_algorithm(target, 0, NULL, 2, reg_params,
+			crc_algorithm->address, 0, timeout, &arm_algo);
+
+	if (retval == ERROR_OK)
+		*checksum = buf_get_u32(reg_params[0].value, 0, 32);
+	else
+		LOG_ERROR("error executing aarch64 crc algorithm");
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+cleanup:
+	target_free_working_area(target, crc_algorithm);
 
-	return ERROR_OK;
+	return retval;
 }
 
-static int aarch64_read_cpu_memory_fast(struct target *target,
-	uint32_t count, uint8_t *buffer, uint32_t *dscr)
+static int aarch64_fill_memory(struct target *target,
+	target_addr_t address, uint32_t size, const uint8_t *pattern)
 {
-	struct armv8_common *armv8 = target_to_armv8(target);
-	struct arm_dpm *dpm = &armv8->dpm;
-	struct arm *arm = &armv8->arm;
+	struct working_area *fill_algorithm;
+	struct arm_algorithm arm_algo;
+	struct reg_param reg_params[3];
 	int retval;
-	uint32_t value;
 
-	/* Mark X1 as dirty */
-	armv8_reg_current(arm, 1)->dirty = true;
-
-	if (arm->core_state == ARM_STATE_AARCH64) {
-		/* Step 1.d - Dummy operation to ensure EDSCR.Txfull == 1 */
-		retval = dpm->instr_execute(dpm, ARMV8_MSR_GP(SYSTEM_DBG_DBGDTR_EL0, 0));
-	} else {
-		/* Step 1.d - Dummy operation to ensure EDSCR.Txfull == 1 */
-		retval = dpm->instr_execute(dpm, ARMV4_5_MCR(14, 0, 0, 0, 5, 0));
-	}
+	static const uint8_t aarch64_fill_code[] = {
+#include "../../contrib/loaders/fill/armv8_fill.inc"
+	};
 
+	retval = target_alloc_working_area(target, sizeof(aarch64_fill_code),
+			&fill_algorithm);
 	if (retval != ERROR_OK)
-		return retval;
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 
-	/* Step 1.e - Change DCC to memory mode */
-	*dscr |= DSCR_MA;
-	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
+	retval = target_write_buffer(target, fill_algorithm->address,
+			sizeof(aarch64_fill_code), aarch64_fill_code);
+	if (retval == ERROR_OK)
+		retval = aarch64_sync_algorithm_code(target, fill_algorithm,
+				sizeof(aarch64_fill_code));
 	if (retval != ERROR_OK)
-		return retval;
+		goto cleanup;
 
-	/* Step 1.f - read DBGDTRTX and discard the value */
-	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_DTRTX, &value);
-	if (retval != ERROR_OK)
-		return retval;
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_ANY;
+	arm_algo.core_state = ARM_STATE_AARCH64;
 
-	count--;
-	/* Read the data - Each read of the DTRTX register causes the instruction to be reissued
-	 * Abort flags are sticky, so can be read at end of transactions
-	 *
-	 * This data is read in aligned to 32 bit boundary.
-	 */
+	init_reg_param(&reg_params[0], "x0", 64, PARAM_OUT);
+	init_reg_param(&reg_params[1], "x1", 64, PARAM_OUT);
+	init_reg_param(&reg_params[2], "x2", 64, PARAM_OUT);
 
-	if (count) {
-		/* Step 2.a - Loop n-1 times, each read of DBGDTRTX reads the data from [X0] and
-		 * increments X0 by 4. */
-		retval = mem_ap_read_buf_noincr(armv8->debug_ap, buffer, 4, count,
-									armv8->debug_base + CPUV8_DBG_DTRTX);
-		if (retval != ERROR_OK)
-			return retval;
-	}
+	buf_set_u64(reg_params[0].value, 0, 64, address);
+	buf_set_u64(reg_params[1].value, 0, 64, size);
+	buf_set_u64(reg_params[2].value, 0, 64, target_buffer_get_u64(target, pattern));
 
-	/* Step 3.a - set DTR access mode back to Normal mode	*/
-	*dscr &= ~DSCR_MA;
-	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
-					armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
-	if (retval != ERROR_OK)
-		return retval;
+	/* assume at least 1 MB/s */
+	int timeout = 2000 + size / 1000;
 
-	/* Step 3.b - read DBGDTRTX for the final value */
-	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_DTRTX, &value);
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			fill_algorithm->address, 0, timeout, &arm_algo);
 	if (retval != ERROR_OK)
-		return retval;
+		LOG_ERROR("error executing aarch64 fill algorithm");
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+cleanup:
+	target_free_working_area(target, fill_algorithm);
 
-	target_buffer_set_u32(target, buffer + count * 4, value);
 	return retval;
 }
 
-static int aarch64_read_cpu_memory(struct target *target,
-	target_addr_t address, uint32_t size,
-	uint32_t count, uint8_t *buffer)
+/** Checks an array of memory regions whether they are erased. */
+static int aarch64_blank_check_memory(struct target *target,
+	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value)
 {
-	/* read memory through APB-AP */
-	int retval = ERROR_COMMAND_SYNTAX_ERROR;
-	struct armv8_common *armv8 = target_to_armv8(target);
-	struct arm_dpm *dpm = &armv8->dpm;
-	struct arm *arm = &armv8->arm;
-	uint32_t dscr;
-
-	LOG_DEBUG("Reading CPU memory address 0x%016" PRIx64 " size %" PRIu32 " count %" PRIu32,
-			address, size, count);
+	struct working_area *erase_check_algorithm;
+	struct working_area *erase_check_params;
+	struct reg_param reg_params[2];
+	struct arm_algorithm arm_algo;
+	int retval;
 
-	if (target->state != TARGET_HALTED) {
-		LOG_WARNING("target not halted");
-		return ERROR_TARGET_NOT_HALTED;
-	}
+	static bool timed_out;
 
-	/* Mark register X0 as dirty, as it will be used
-	 * for transferring the data.
-	 * It will be restored automatically when exiting
-	 * debug mode
-	 */
-	armv8_reg_current(arm, 0)->dirty = true;
+	static const uint8_t erase_check_code[] = {
+#include "../../contrib/loaders/erase_check/armv8_erase_check.inc"
+	};
 
-	/* Read DSCR */
-	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
-				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
-	if (retval != ERROR_OK)
-		return retval;
+	const uint32_t code_size = sizeof(erase_check_code);
 
-	/* This algorithm comes from DDI0487A.g, chapter J9.1 */
+	/* make sure we have a working area */
+	if (target_alloc_working_area(target, code_size,
+		&erase_check_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 
-	/* Set Normal access mode  */
-	dscr &= ~DSCR_MA;
-	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_DSCR, dscr);
+	retval = target_write_buffer(target, erase_check_algorithm->address,
+			code_size, erase_check_code);
+	if (retval == ERROR_OK)
+		retval = aarch64_sync_algorithm_code(target, erase_check_algorithm,
+				code_size);
 	if (retval != ERROR_OK)
-		return retval;
+		goto cleanup1;
+
+	/* prepare blocks array for algo */
+	struct algo_block {
+		union {
+			uint64_t size;
+			uint64_t result;
+		};
+		uint64_t address;
+	};
 
-	if (arm->core_state == ARM_STATE_AARCH64) {
-		/* Write X0 with value 'address' using write procedure */
-		/* Step 1.a+b - Write the address for read access into DBGDTR_EL0 */
-		/* Step 1.c   - Copy value from DTR to R0 using instruction mrs DBGDTR_EL0, x0 */
-		retval = dpm->instr_write_data_dcc_64(dpm,
-				ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0), address);
-	} else {
-		/* Write R0 with value 'address' using write procedure */
-		/* Step 1.a+b - Write the address for read access into DBGDTRRXint */
-		/* Step 1.c   - Copy value from DTR to R0 using instruction mrc DBGDTRTXint, r0 */
-		retval = dpm->instr_write_data_dcc(dpm,
-				ARMV4_5_MRC(14, 0, 0, 0, 5, 0), address);
+	uint32_t avail = target_get_working_area_avail(target);
+	int blocks_to_check = avail / sizeof(struct algo_block) - 1;
+	if (num_blocks < blocks_to_check)
+		blocks_to_check = num_blocks;
+	if (blocks_to_check <= 0) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup1;
 	}
 
-	if (retval != ERROR_OK)
-		return retval;
+	struct algo_block *params = malloc((blocks_to_check + 1) * sizeof(struct algo_block));
+	if (params == NULL) {
+		retval = ERROR_FAIL;
+		goto cleanup1;
+	}
 
-	if (size == 4 && (address % 4) == 0)
-		retval = aarch64_read_cpu_memory_fast(target, count, buffer, &dscr);
-	else
-		retval = aarch64_read_cpu_memory_slow(target, size, count, buffer, &dscr);
+	int i;
+	uint32_t total_size = 0;
+	for (i = 0; i < blocks_to_check; i++) {
+		total_size += blocks[i].size;
+		target_buffer_set_u64(target, (uint8_t *)&(params[i].size),
+						blocks[i].size / sizeof(uint32_t));
+		target_buffer_set_u64(target, (uint8_t *)&(params[i].address),
+						blocks[i].address);
+	}
+	target_buffer_set_u64(target, (uint8_t *)&(params[blocks_to_check].size), 0);
 
-	if (dscr & DSCR_MA) {
-		dscr &= ~DSCR_MA;
-		mem_ap_write_atomic_u32(armv8->debug_ap,
-					armv8->debug_base + CPUV8_DBG_DSCR, dscr);
+	uint32_t param_size = (blocks_to_check + 1) * sizeof(struct algo_block);
+	if (target_alloc_working_area(target, param_size,
+			&erase_check_params) != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup2;
 	}
 
+	retval = target_write_buffer(target, erase_check_params->address,
+				param_size, (uint8_t *)params);
 	if (retval != ERROR_OK)
-		return retval;
+		goto cleanup3;
 
-	/* Check for sticky abort flags in the DSCR */
-	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
-				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
-	if (retval != ERROR_OK)
-		return retval;
+	uint32_t erased_word = erased_value | (erased_value << 8)
+			       | (erased_value << 16) | (erased_value << 24);
 
-	dpm->dscr = dscr;
+	LOG_DEBUG("Starting erase check of %d blocks, parameters@"
+		 TARGET_ADDR_FMT, blocks_to_check, erase_check_params->address);
 
-	if (dscr & (DSCR_ERR | DSCR_SYS_ERROR_PEND)) {
-		/* Abort occurred - clear it and exit */
-		LOG_ERROR("abort occurred - dscr = 0x%08" PRIx32, dscr);
-		armv8_dpm_handle_exception(dpm, true);
-		return ERROR_FAIL;
-	}
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_ANY;
+	arm_algo.core_state = ARM_STATE_AARCH64;
 
-	/* Done */
-	return ERROR_OK;
-}
+	init_reg_param(&reg_params[0], "x0", 64, PARAM_OUT);
+	buf_set_u64(reg_params[0].value, 0, 64, erase_check_params->address);
 
-static int aarch64_read_phys_memory(struct target *target,
-	target_addr_t address, uint32_t size,
-	uint32_t count, uint8_t *buffer)
-{
-	int retval = ERROR_COMMAND_SYNTAX_ERROR;
+	init_reg_param(&reg_params[1], "x1", 64, PARAM_OUT);
+	buf_set_u64(reg_params[1].value, 0, 64, erased_word);
 
-	if (count && buffer) {
-		/* read memory through APB-AP */
-		retval = aarch64_mmu_modify(target, 0);
-		if (retval != ERROR_OK)
-			return retval;
-		retval = aarch64_read_cpu_memory(target, address, size, count, buffer);
-	}
-	return retval;
-}
+	int timeout = (timed_out ? 30000 : 2000) + total_size * 3 / 1000;
 
-static int aarch64_read_memory(struct target *target, target_addr_t address,
-	uint32_t size, uint32_t count, uint8_t *buffer)
-{
-	int mmu_enabled = 0;
-	int retval;
+	retval = target_run_algorithm(target,
+				0, NULL,
+				ARRAY_SIZE(reg_params), reg_params,
+				erase_check_algorithm->address, 0,
+				timeout,
+				&arm_algo);
 
-	/* determine if MMU was enabled on target stop */
-	retval = aarch64_mmu(target, &mmu_enabled);
-	if (retval != ERROR_OK)
-		return retval;
+	timed_out = retval == ERROR_TARGET_TIMEOUT;
+	if (retval != ERROR_OK && !timed_out)
+		goto cleanup4;
 
-	if (mmu_enabled) {
-		/* enable MMU as we could have disabled it for phys access */
-		retval = aarch64_mmu_modify(target, 1);
-		if (retval != ERROR_OK)
-			return retval;
-	}
-	return aarch64_read_cpu_memory(target, address, size, count, buffer);
-}
+	retval = target_read_buffer(target, erase_check_params->address,
+				param_size, (uint8_t *)params);
+	if (retval != ERROR_OK)
+		goto cleanup4;
 
-static int aarch64_write_phys_memory(struct target *target,
-	target_addr_t address, uint32_t size,
-	uint32_t count, const uint8_t *buffer)
-{
-	int retval = ERROR_COMMAND_SYNTAX_ERROR;
+	for (i = 0; i < blocks_to_check; i++) {
+		uint64_t result = target_buffer_get_u64(target,
+					(uint8_t *)&(params[i].result));
+		if (result != 0 && result != 1)
+			break;
 
-	if (count && buffer) {
-		/* write memory through APB-AP */
-		retval = aarch64_mmu_modify(target, 0);
-		if (retval != ERROR_OK)
-			return retval;
-		return aarch64_write_cpu_memory(target, address, size, count, buffer);
+		blocks[i].result = result;
 	}
+	if (i && timed_out)
+		LOG_INFO("Slow CPU clock: %d blocks checked, %d remain. Continuing...", i, num_blocks-i);
 
-	return retval;
-}
+	retval = i;		/* return number of blocks really checked */
 
-static int aarch64_write_memory(struct target *target, target_addr_t address,
-	uint32_t size, uint32_t count, const uint8_t *buffer)
-{
-	int mmu_enabled = 0;
-	int retval;
+cleanup4:
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
 
-	/* determine if MMU was enabled on target stop */
-	retval = aarch64_mmu(target, &mmu_enabled);
-	if (retval != ERROR_OK)
-		return retval;
+cleanup3:
+	target_free_working_area(target, erase_check_params);
+cleanup2:
+	free(params);
+cleanup1:
+	target_free_working_area(target, erase_check_algorithm);
 
-	if (mmu_enabled) {
-		/* enable MMU as we could have disabled it for phys access */
-		retval = aarch64_mmu_modify(target, 1);
-		if (retval != ERROR_OK)
-			return retval;
-	}
-	return aarch64_write_cpu_memory(target, address, size, count, buffer);
+	return retval;
 }
 
 static int aarch64_handle_target_request(void *priv)
@@ -2243,18 +2997,13 @@ static int aarch64_handle_target_request(void *priv)
 	return ERROR_OK;
 }
 
-static int aarch64_examine_first(struct target *target)
+static int aarch64_examine_ap(struct target *target)
 {
 	struct aarch64_common *aarch64 = target_to_aarch64(target);
 	struct armv8_common *armv8 = &aarch64->armv8_common;
 	struct adiv5_dap *swjdp = armv8->arm.dap;
 	struct aarch64_private_config *pc = target->private_config;
-	int i;
-	int retval = ERROR_OK;
-	uint64_t debug, ttypr;
-	uint32_t cpuid;
-	uint32_t tmp0, tmp1, tmp2, tmp3;
-	debug = ttypr = cpuid = 0;
+	int retval;
 
 	if (pc == NULL)
 		return ERROR_FAIL;
@@ -2296,7 +3045,17 @@ static int aarch64_examine_first(struct target *target)
 	} else
 		armv8->debug_base = target->dbgbase;
 
-	retval = mem_ap_write_atomic_u32(armv8->debug_ap,
+	return ERROR_OK;
+}
+
+/* queue the OS lock release and the identification reads, no flush */
+static int aarch64_examine_queue_regs(struct target *target)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+	int retval;
+
+	retval = mem_ap_write_u32(armv8->debug_ap,
 			armv8->debug_base + CPUV8_DBG_OSLAR, 0);
 	if (retval != ERROR_OK) {
 		LOG_DEBUG("Examine %s failed", "oslock");
@@ -2304,39 +3063,88 @@ static int aarch64_examine_first(struct target *target)
 	}
 
 	retval = mem_ap_read_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_MAINID0, &cpuid);
+			armv8->debug_base + CPUV8_DBG_MAINID0, &aarch64->examine_cpuid);
 	if (retval != ERROR_OK) {
 		LOG_DEBUG("Examine %s failed", "CPUID");
 		return retval;
 	}
 
 	retval = mem_ap_read_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_MEMFEATURE0, &tmp0);
+			armv8->debug_base + CPUV8_DBG_MEMFEATURE0, &aarch64->examine_ttypr[0]);
 	retval += mem_ap_read_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_MEMFEATURE0 + 4, &tmp1);
+			armv8->debug_base + CPUV8_DBG_MEMFEATURE0 + 4, &aarch64->examine_ttypr[1]);
 	if (retval != ERROR_OK) {
 		LOG_DEBUG("Examine %s failed", "Memory Model Type");
 		return retval;
 	}
 	retval = mem_ap_read_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_DBGFEATURE0, &tmp2);
+			armv8->debug_base + CPUV8_DBG_DBGFEATURE0, &aarch64->examine_debug[0]);
 	retval += mem_ap_read_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_DBGFEATURE0 + 4, &tmp3);
+			armv8->debug_base + CPUV8_DBG_DBGFEATURE0 + 4, &aarch64->examine_debug[1]);
 	if (retval != ERROR_OK) {
 		LOG_DEBUG("Examine %s failed", "ID_AA64DFR0_EL1");
 		return retval;
 	}
 
-	retval = dap_run(armv8->debug_ap->dap);
+	return ERROR_OK;
+}
+
+static int aarch64_examine_queue(struct target *target)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+	int retval;
+
+	aarch64->examine_is_queued = false;
+	if (target_was_examined(target))
+		return ERROR_OK;
+
+	retval = aarch64_examine_ap(target);
+	if (retval == ERROR_OK)
+		retval = aarch64_examine_queue_regs(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	aarch64->examine_is_queued = true;
+	aarch64->examine_queued_at = armv8->debug_ap->dap->run_count;
+	return ERROR_OK;
+}
+
+static int aarch64_examine_first(struct target *target)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+	struct aarch64_private_config *pc = target->private_config;
+	int i;
+	int retval = ERROR_OK;
+	uint64_t debug, ttypr;
+	uint32_t cpuid;
+	bool queued = aarch64->examine_is_queued;
+
+	aarch64->examine_is_queued = false;
+	if (!queued) {
+		retval = aarch64_examine_ap(target);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	/* complete the reads aarch64_examine_queue() left in the queue, or redo them */
+	if (queued)
+		retval = dap_run_queued(armv8->debug_ap->dap, aarch64->examine_queued_at);
+	if (!queued || retval != ERROR_OK) {
+		retval = aarch64_examine_queue_regs(target);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = dap_run(armv8->debug_ap->dap);
+	}
 	if (retval != ERROR_OK) {
 		LOG_ERROR("%s: examination failed\n", target_name(target));
 		return retval;
 	}
 
-	ttypr |= tmp1;
-	ttypr = (ttypr << 32) | tmp0;
-	debug |= tmp3;
-	debug = (debug << 32) | tmp2;
+	cpuid = aarch64->examine_cpuid;
+	ttypr = ((uint64_t)aarch64->examine_ttypr[1] << 32) | aarch64->examine_ttypr[0];
+	debug = ((uint64_t)aarch64->examine_debug[1] << 32) | aarch64->examine_debug[0];
 
 	LOG_DEBUG("cpuid = 0x%08" PRIx32, cpuid);
 	LOG_DEBUG("ttypr = 0x%08" PRIx64, ttypr);
@@ -2863,6 +3671,7 @@ struct target_type aarch64_target = {
 	.name = "aarch64",
 
 	.poll = aarch64_poll,
+	.poll_queue = aarch64_poll_queue,
 	.arch_state = armv8_arch_state,
 
 	.halt = aarch64_halt,
@@ -2879,6 +3688,12 @@ struct target_type aarch64_target = {
 	.read_memory = aarch64_read_memory,
 	.write_memory = aarch64_write_memory,
 
+	.checksum_memory = aarch64_checksum_memory,
+	.blank_check_memory = aarch64_blank_check_memory,
+	.fill_memory = aarch64_fill_memory,
+
+	.run_algorithm = aarch64_run_algorithm,
+
 	.add_breakpoint = aarch64_add_breakpoint,
 	.add_context_breakpoint = aarch64_add_context_breakpoint,
 	.add_hybrid_breakpoint = aarch64_add_hybrid_breakpoint,
@@ -2892,6 +3707,7 @@ struct target_type aarch64_target = {
 	.init_target = aarch64_init_target,
 	.deinit_target = aarch64_deinit_target,
 	.examine = aarch64_examine,
+	.examine_queue = aarch64_examine_queue,
 
 	.read_phys_memory = aarch64_read_phys_memory,
 	.write_phys_memory = aarch64_write_phys_memory,
@@ -56,6 +56,25 @@ struct aarch64_common {
 	uint32_t system_control_reg;
 	uint32_t system_control_reg_curr;
 
+	/* PRSR read queued by aarch64_poll_queue(), consumed by the next poll */
+	uint32_t prsr_queued;
+	bool prsr_is_queued;
+	unsigned int prsr_queued_at;
+
+	/* scratch for the batched SMP halt/restart sequences */
+	bool smp_selected;
+	uint32_t smp_dscr;
+	uint32_t smp_prsr;
+	uint32_t smp_cti_gate;
+	uint32_t smp_cti_trout;
+
+	/* identification reads queued by aarch64_examine_queue() */
+	uint32_t examine_cpuid;
+	uint32_t examine_ttypr[2];
+	uint32_t examine_debug[2];
+	bool examine_is_queued;
+	unsigned int examine_queued_at;
+
 	/* Breakpoint register pairs */
 	int brp_num_context;
 	int brp_num;
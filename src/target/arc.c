@@ -441,7 +441,7 @@ static int arc_build_bcr_reg_cache(struct target *target)
 	struct arc_common *arc = target_to_arc(target);
 	const unsigned long num_regs = arc->num_bcr_regs;
 	struct reg_cache **cache_p = register_get_last_cache_p(&target->reg_cache);
-	struct reg_cache *cache = malloc(sizeof(*cache));
+	struct reg_cache *cache = calloc(1, sizeof(*cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(*reg_list));
 
 	struct arc_reg_desc *reg_desc;
@@ -1547,6 +1547,7 @@ static int arc_init_target(struct command_context *cmd_ctx, struct target *targe
 static void arc_free_reg_cache(struct reg_cache *cache)
 {
 	free(cache->reg_list);
+	register_cache_index_free(cache);
 	free(cache);
 }
 
@@ -1928,6 +1929,7 @@ void arc_reset_actionpoints(struct target *target)
 		free(target->watchpoints);
 		target->watchpoints = next_w;
 	}
+	bpwp_index_free(target);
 	for (unsigned int i = 0; i < arc->actionpoints_num; i++) {
 		if ((ap_list[i].used) && (ap_list[i].reg_address))
 			arc_remove_auxreg_actionpoint(target, ap_list[i].reg_address);
@@ -203,6 +203,11 @@ struct arm {
 	/** Floating point or VFP version, 0 if disabled. */
 	int arm_vfp_version;
 
+	/** Read every core register on debug entry, instead of only those
+	 * needed to handle the halt and reading the others on first access.
+	 * Honoured by Cortex-M and ARMv7-A cores, see "arm reg_fetch". */
+	bool eager_reg_fetch;
+
 	int (*setup_semihosting)(struct target *target, int enable);
 
 	/** Backpointer to the target. */
@@ -309,6 +314,8 @@ int armv4_5_run_algorithm_inner(struct target *target,
 
 int arm_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
+int arm_fill_memory(struct target *target,
+		target_addr_t address, uint32_t size, const uint8_t *pattern);
 int arm_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
 
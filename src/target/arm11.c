@@ -1378,6 +1378,7 @@ struct target_type arm11_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.add_breakpoint = arm11_add_breakpoint,
 	.remove_breakpoint = arm11_remove_breakpoint,
@@ -1715,6 +1715,7 @@ struct target_type arm920t_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
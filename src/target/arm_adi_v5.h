@@ -294,6 +294,16 @@ struct adiv5_dap {
 	/** Flag saying whether to ignore the syspwrupack flag in DAP. Some devices
 	 *  do not set this bit until later in the bringup sequence */
 	bool ignore_syspwrupack;
+
+	/**
+	 * Number of dap_run() calls so far, the result of the latest one and
+	 * the number of the latest one that failed. Lets a read queued by one
+	 * core be completed after another core on the same DAP flushed the
+	 * queue, see dap_run_queued().
+	 */
+	unsigned int run_count;
+	int run_result;
+	unsigned int run_failed_at;
 };
 
 /**
@@ -472,7 +482,29 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 static inline int dap_run(struct adiv5_dap *dap)
 {
 	assert(dap->ops != NULL);
-	return dap->ops->run(dap);
+	dap->run_result = dap->ops->run(dap);
+	dap->run_count++;
+	if (dap->run_result != ERROR_OK)
+		dap->run_failed_at = dap->run_count;
+	return dap->run_result;
+}
+
+/**
+ * Complete transactions queued when dap->run_count was @a queued_at.
+ * Flushes the queue unless somebody else already did; then the result
+ * of that flush is returned. ERROR_WAIT means the outcome is no longer
+ * known because more flushes followed and one of them failed, and the
+ * caller must retry.
+ */
+static inline int dap_run_queued(struct adiv5_dap *dap, unsigned int queued_at)
+{
+	if (dap->run_count == queued_at)
+		return dap_run(dap);
+	if (dap->run_count == queued_at + 1)
+		return dap->run_result;
+	if (dap->run_failed_at <= queued_at)
+		return ERROR_OK;
+	return ERROR_WAIT;
 }
 
 static inline int dap_sync(struct adiv5_dap *dap)
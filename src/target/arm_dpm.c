@@ -370,8 +370,12 @@ int arm_dpm_read_current_registers(struct arm_dpm *dpm)
 	/* update core mode and state, plus shadow mapping for R8..R14 */
 	arm_set_cpsr(arm, cpsr);
 
-	/* REVISIT we can probably avoid reading R1..R14, saving time... */
+	/* R2..R13 are only read on first access unless asked otherwise;
+	 * LR and PC are needed to handle the halt (e.g. semihosting) */
 	for (unsigned i = 2; i < 16; i++) {
+		if (!arm->eager_reg_fetch && i < 14)
+			continue;
+
 		r = arm_reg_current(arm, i);
 		if (r->valid)
 			continue;
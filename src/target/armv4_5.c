@@ -661,7 +661,7 @@ struct reg_cache *arm_build_reg_cache(struct target *target, struct arm *arm)
 	if (arm->arm_vfp_version == ARM_VFP_V3)
 		num_regs += ARRAY_SIZE(arm_vfp_v3_regs);
 
-	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(struct reg));
 	struct arm_reg *reg_arch_info = calloc(num_regs, sizeof(struct arm_reg));
 	int i;
@@ -785,6 +785,7 @@ void arm_free_reg_cache(struct arm *arm)
 
 	free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
+	register_cache_index_free(cache);
 	free(cache);
 
 	arm->core_cache = NULL;
@@ -1123,6 +1124,33 @@ static int jim_mcrmrc(Jim_Interp *interp, int argc, Jim_Obj * const *argv)
 	return JIM_OK;
 }
 
+COMMAND_HANDLER(handle_arm_reg_fetch_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct arm *arm = target_to_arm(target);
+
+	if (!is_arm(arm)) {
+		command_print(CMD, "current target isn't an ARM");
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "eager") == 0)
+			arm->eager_reg_fetch = true;
+		else if (strcmp(CMD_ARGV[0], "lazy") == 0)
+			arm->eager_reg_fetch = false;
+		else
+			return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	command_print(CMD, "core registers are fetched %s",
+			arm->eager_reg_fetch ? "eagerly on halt" : "lazily on first access");
+	return ERROR_OK;
+}
+
 extern const struct command_registration semihosting_common_handlers[];
 
 static const struct command_registration arm_exec_command_handlers[] = {
@@ -1140,6 +1168,14 @@ static const struct command_registration arm_exec_command_handlers[] = {
 		.usage = "['arm'|'thumb']",
 		.help = "display/change ARM core state",
 	},
+	{
+		.name = "reg_fetch",
+		.handler = handle_arm_reg_fetch_command,
+		.mode = COMMAND_ANY,
+		.usage = "['eager'|'lazy']",
+		.help = "display/change whether all core registers are read "
+			"when the core halts",
+	},
 	{
 		.name = "disassemble",
 		.handler = handle_arm_disassemble_command,
@@ -1463,6 +1499,14 @@ int armv4_5_run_algorithm_inner(struct target *target,
 				continue;
 			}
 
+			if (!reg->valid) {
+				int retvaltemp = reg->type->get(reg);
+				if (retvaltemp != ERROR_OK) {
+					retval = retvaltemp;
+					continue;
+				}
+			}
+
 			buf_set_u32(reg_params[i].value, 0, 32, buf_get_u32(reg->value, 0, 32));
 		}
 	}
@@ -1472,7 +1516,9 @@ int armv4_5_run_algorithm_inner(struct target *target,
 		uint32_t regvalue;
 		regvalue = buf_get_u32(ARMV4_5_CORE_REG_MODE(arm->core_cache,
 				arm_algorithm_info->core_mode, i).value, 0, 32);
-		if (regvalue != context[i]) {
+		/* registers not fetched since the halt can't be compared */
+		if (!ARMV4_5_CORE_REG_MODE(arm->core_cache, arm_algorithm_info->core_mode, i).valid
+				|| regvalue != context[i]) {
 			LOG_DEBUG("restoring register %s with value 0x%8.8" PRIx32 "",
 				ARMV4_5_CORE_REG_MODE(arm->core_cache,
 				arm_algorithm_info->core_mode, i).name, context[i]);
@@ -1536,19 +1582,17 @@ int arm_checksum_memory(struct target *target,
 
 	assert(sizeof(arm_crc_code_le) % 4 == 0);
 
-	retval = target_alloc_working_area(target,
-			sizeof(arm_crc_code_le), &crc_algorithm);
-	if (retval != ERROR_OK)
-		return retval;
-
 	/* convert code into a buffer in target endianness */
-	for (i = 0; i < ARRAY_SIZE(arm_crc_code_le) / 4; i++) {
-		retval = target_write_u32(target,
-				crc_algorithm->address + i * sizeof(uint32_t),
+	uint8_t arm_crc_code[sizeof(arm_crc_code_le)];
+	for (i = 0; i < ARRAY_SIZE(arm_crc_code_le) / 4; i++)
+		target_buffer_set_u32(target, arm_crc_code + i * sizeof(uint32_t),
 				le_to_h_u32(&arm_crc_code_le[i * 4]));
-		if (retval != ERROR_OK)
-			goto cleanup;
-	}
+
+	/* kept resident, block-wise callers like mem_snapshot run it many times */
+	retval = target_alloc_resident_working_area(target, "arm_crc",
+			arm_crc_code, sizeof(arm_crc_code), &crc_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
 
 	arm_algo.common_magic = ARM_COMMON_MAGIC;
 	arm_algo.core_mode = ARM_MODE_SVC;
@@ -1580,12 +1624,83 @@ int arm_checksum_memory(struct target *target,
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 
-cleanup:
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
 }
 
+/**
+ * Runs ARM code in the target to fill a memory block with a repeated
+ * 8 byte pattern.
+ */
+int arm_fill_memory(struct target *target,
+	target_addr_t address, uint32_t size, const uint8_t *pattern)
+{
+	struct working_area *fill_algorithm;
+	struct arm_algorithm arm_algo;
+	struct arm *arm = target_to_arm(target);
+	struct reg_param reg_params[4];
+	int retval;
+	uint32_t i;
+	uint32_t exit_var = 0;
+
+	static const uint8_t arm_fill_code_le[] = {
+#include "../../contrib/loaders/fill/armv4_5_fill.inc"
+	};
+
+	assert(sizeof(arm_fill_code_le) % 4 == 0);
+
+	retval = target_alloc_working_area(target,
+			sizeof(arm_fill_code_le), &fill_algorithm);
+	if (retval != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* convert code into a buffer in target endianness */
+	for (i = 0; i < ARRAY_SIZE(arm_fill_code_le) / 4; i++) {
+		retval = target_write_u32(target,
+				fill_algorithm->address + i * sizeof(uint32_t),
+				le_to_h_u32(&arm_fill_code_le[i * 4]));
+		if (retval != ERROR_OK)
+			goto cleanup;
+	}
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_SVC;
+	arm_algo.core_state = ARM_STATE_ARM;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, size);
+	buf_set_u32(reg_params[2].value, 0, 32, target_buffer_get_u32(target, pattern));
+	buf_set_u32(reg_params[3].value, 0, 32, target_buffer_get_u32(target, pattern + 4));
+
+	/* assume at least 1 MB/s */
+	int timeout = 2000 + size / 1000;
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = fill_algorithm->address + sizeof(arm_fill_code_le) - 4;
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			fill_algorithm->address,
+			exit_var,
+			timeout, &arm_algo);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing ARM fill algorithm");
+
+	for (i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+cleanup:
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
 /**
  * Runs ARM code in the target to check whether a memory block holds
  * all ones.  NOR flash which has been erased, and thus may be written,
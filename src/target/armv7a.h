@@ -148,6 +148,8 @@ static inline bool is_armv7a(struct armv7a_common *armv7a)
 /* See ARMv7a arch spec section C10.3 */
 #define CPUDBG_WFAR		0x018
 /* PCSR at 0x084 -or- 0x0a0 -or- both ... based on flags in DIDR */
+#define CPUDBG_PCSR_R33		0x084
+#define CPUDBG_PCSR		0x0A0
 #define CPUDBG_DSCR		0x088
 #define CPUDBG_DRCR		0x090
 #define CPUDBG_PRCR		0x310
@@ -177,6 +179,8 @@ static inline bool is_armv7a(struct armv7a_common *armv7a)
 
 /* See ARMv7a arch spec section C10.8 */
 #define CPUDBG_AUTHSTATUS	0xFB8
+#define CPUDBG_DEVID1		0xFC4
+#define CPUDBG_DEVID		0xFC8
 
 /* See ARMv7a arch spec DDI 0406C C11.10 */
 #define CPUDBG_ID_PFR1		0xD24
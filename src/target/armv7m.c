@@ -191,6 +191,12 @@ static int armv7m_get_core_reg(struct reg *reg)
 	if (target->state != TARGET_HALTED)
 		return ERROR_TARGET_NOT_HALTED;
 
+	/* registers left unread on halt are most likely all wanted now */
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	if (armv7m->load_core_regs && armv7m->load_core_regs(target) == ERROR_OK
+			&& reg->valid)
+		return ERROR_OK;
+
 	retval = arm->read_core_reg(target, reg, reg->number, arm->core_mode);
 
 	return retval;
@@ -370,9 +376,15 @@ int armv7m_start_algorithm(struct target *target,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	/* refresh core register cache
-	 * Not needed if core register cache is always consistent with target process state */
+	/* refresh core register cache, registers may be left unread on halt */
 	for (unsigned i = 0; i < armv7m->arm.core_cache->num_regs; i++) {
+		struct reg *r = &armv7m->arm.core_cache->reg_list[i];
+
+		if (!r->valid) {
+			retval = r->type->get(r);
+			if (retval != ERROR_OK)
+				return retval;
+		}
 
 		armv7m_algorithm_info->context[i] = buf_get_u32(
 				armv7m->arm.core_cache->reg_list[i].value,
@@ -525,6 +537,12 @@ int armv7m_wait_algorithm(struct target *target,
 				return ERROR_COMMAND_SYNTAX_ERROR;
 			}
 
+			if (!reg->valid) {
+				retval = reg->type->get(reg);
+				if (retval != ERROR_OK)
+					return retval;
+			}
+
 			buf_set_u32(reg_params[i].value, 0, 32, buf_get_u32(reg->value, 0, 32));
 		}
 	}
@@ -532,7 +550,9 @@ int armv7m_wait_algorithm(struct target *target,
 	for (int i = armv7m->arm.core_cache->num_regs - 1; i >= 0; i--) {
 		uint32_t regvalue;
 		regvalue = buf_get_u32(armv7m->arm.core_cache->reg_list[i].value, 0, 32);
-		if (regvalue != armv7m_algorithm_info->context[i]) {
+		/* registers not fetched since the halt can't be compared */
+		if (!armv7m->arm.core_cache->reg_list[i].valid
+				|| regvalue != armv7m_algorithm_info->context[i]) {
 			LOG_DEBUG("restoring register %s with value 0x%8.8" PRIx32,
 					armv7m->arm.core_cache->reg_list[i].name,
 				armv7m_algorithm_info->context[i]);
@@ -568,8 +588,16 @@ int armv7m_arch_state(struct target *target)
 	if (target->semihosting && target->semihosting->hit_fileio)
 		return ERROR_OK;
 
-	ctrl = buf_get_u32(arm->core_cache->reg_list[ARMV7M_CONTROL].value, 0, 32);
-	sp = buf_get_u32(arm->core_cache->reg_list[ARMV7M_R13].value, 0, 32);
+	/* registers may be fetched lazily after a halt */
+	struct reg *ctrl_reg = &arm->core_cache->reg_list[ARMV7M_CONTROL];
+	struct reg *sp_reg = &arm->core_cache->reg_list[ARMV7M_R13];
+	if (!ctrl_reg->valid && ctrl_reg->type->get(ctrl_reg) != ERROR_OK)
+		return ERROR_FAIL;
+	if (!sp_reg->valid && sp_reg->type->get(sp_reg) != ERROR_OK)
+		return ERROR_FAIL;
+
+	ctrl = buf_get_u32(ctrl_reg->value, 0, 32);
+	sp = buf_get_u32(sp_reg->value, 0, 32);
 
 	LOG_USER("target halted due to %s, current mode: %s %s\n"
 		"xPSR: %#8.8" PRIx32 " pc: %#8.8" PRIx32 " %csp: %#8.8" PRIx32 "%s%s",
@@ -598,7 +626,7 @@ struct reg_cache *armv7m_build_reg_cache(struct target *target)
 	struct arm *arm = &armv7m->arm;
 	int num_regs = ARMV7M_NUM_REGS;
 	struct reg_cache **cache_p = register_get_last_cache_p(&target->reg_cache);
-	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(struct reg));
 	struct arm_reg *arch_info = calloc(num_regs, sizeof(struct arm_reg));
 	struct reg_feature *feature;
@@ -676,6 +704,7 @@ void armv7m_free_reg_cache(struct target *target)
 
 	free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
+	register_cache_index_free(cache);
 	free(cache);
 
 	arm->core_cache = NULL;
@@ -721,15 +750,12 @@ int armv7m_checksum_memory(struct target *target,
 #include "../../contrib/loaders/checksum/armv7m_crc.inc"
 	};
 
-	retval = target_alloc_working_area(target, sizeof(cortex_m_crc_code), &crc_algorithm);
+	/* kept resident, block-wise callers like mem_snapshot run it many times */
+	retval = target_alloc_resident_working_area(target, "armv7m_crc",
+			cortex_m_crc_code, sizeof(cortex_m_crc_code), &crc_algorithm);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = target_write_buffer(target, crc_algorithm->address,
-			sizeof(cortex_m_crc_code), (uint8_t *)cortex_m_crc_code);
-	if (retval != ERROR_OK)
-		goto cleanup;
-
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
@@ -753,12 +779,65 @@ int armv7m_checksum_memory(struct target *target,
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 
-cleanup:
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
 }
 
+/** Fills memory with a repeated 8 byte pattern using a target algorithm. */
+int armv7m_fill_memory(struct target *target,
+	target_addr_t address, uint32_t size, const uint8_t *pattern)
+{
+	struct working_area *fill_algorithm;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[4];
+	int retval;
+
+	static const uint8_t fill_code[] = {
+#include "../../contrib/loaders/fill/armv7m_fill.inc"
+	};
+
+	retval = target_alloc_working_area(target, sizeof(fill_code), &fill_algorithm);
+	if (retval != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_write_buffer(target, fill_algorithm->address,
+			sizeof(fill_code), fill_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, size);
+	buf_set_u32(reg_params[2].value, 0, 32, target_buffer_get_u32(target, pattern));
+	buf_set_u32(reg_params[3].value, 0, 32, target_buffer_get_u32(target, pattern + 4));
+
+	/* assume at least 1 MB/s */
+	int timeout = 2000 + size / 1000;
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			fill_algorithm->address,
+			fill_algorithm->address + (sizeof(fill_code) - 2),
+			timeout, &armv7m_info);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing cortex_m fill algorithm");
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+cleanup:
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
 /** Checks an array of memory regions whether they are erased. */
 int armv7m_blank_check_memory(struct target *target,
 	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value)
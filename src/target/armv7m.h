@@ -161,6 +161,8 @@ struct armv7m_common {
 	/* Direct processor core register read and writes */
 	int (*load_core_reg_u32)(struct target *target, uint32_t num, uint32_t *value);
 	int (*store_core_reg_u32)(struct target *target, uint32_t num, uint32_t value);
+	/* Optional: read all core registers not valid yet at once */
+	int (*load_core_regs)(struct target *target);
 
 	int (*examine_debug_reason)(struct target *target);
 	int (*post_debug_entry)(struct target *target);
@@ -224,6 +226,8 @@ int armv7m_restore_context(struct target *target);
 
 int armv7m_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
+int armv7m_fill_memory(struct target *target,
+		target_addr_t address, uint32_t size, const uint8_t *pattern);
 int armv7m_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
 
@@ -41,33 +41,125 @@ static const char * const watchpoint_rw_strings[] = {
 /* monotonic counter/id-number for breakpoints and watch points */
 static int bpwp_unique_id;
 
+/*
+ * Breakpoints and watchpoints stay in their target lists, in the order
+ * they were added, but lookups by address go through a hash index so
+ * scripts setting hundreds of breakpoints don't walk the lists over and
+ * over.  Each bucket keeps list order, and context breakpoints (address
+ * zero) live in bucket zero.  The index is only created while both lists
+ * are empty, so when it exists it covers every element; lookups fall
+ * back to the lists if it could not be allocated.
+ */
+static unsigned int bpwp_hash(target_addr_t address)
+{
+	uint32_t h = (uint32_t)(address ^ (address >> 32)) * 2654435761u;
+	return (h >> 16) % BPWP_INDEX_SIZE;
+}
+
+static void bpwp_index_prepare(struct target *target)
+{
+	if (target->bpwp_index == NULL && target->breakpoints == NULL
+			&& target->watchpoints == NULL)
+		target->bpwp_index = calloc(1, sizeof(struct bpwp_index));
+}
+
+void bpwp_index_free(struct target *target)
+{
+	free(target->bpwp_index);
+	target->bpwp_index = NULL;
+}
+
+static void breakpoint_index_add(struct target *target, struct breakpoint *breakpoint)
+{
+	if (target->bpwp_index == NULL)
+		return;
+
+	struct breakpoint **p = &target->bpwp_index->breakpoints[bpwp_hash(breakpoint->address)];
+	while (*p)
+		p = &(*p)->index_next;
+	breakpoint->index_next = NULL;
+	*p = breakpoint;
+}
+
+static void breakpoint_index_remove(struct target *target, struct breakpoint *breakpoint)
+{
+	if (target->bpwp_index == NULL)
+		return;
+
+	struct breakpoint **p = &target->bpwp_index->breakpoints[bpwp_hash(breakpoint->address)];
+	while (*p && *p != breakpoint)
+		p = &(*p)->index_next;
+	if (*p)
+		*p = breakpoint->index_next;
+}
+
+static void watchpoint_index_add(struct target *target, struct watchpoint *watchpoint)
+{
+	if (target->bpwp_index == NULL)
+		return;
+
+	struct watchpoint **p = &target->bpwp_index->watchpoints[bpwp_hash(watchpoint->address)];
+	while (*p)
+		p = &(*p)->index_next;
+	watchpoint->index_next = NULL;
+	*p = watchpoint;
+}
+
+static void watchpoint_index_remove(struct target *target, struct watchpoint *watchpoint)
+{
+	if (target->bpwp_index == NULL)
+		return;
+
+	struct watchpoint **p = &target->bpwp_index->watchpoints[bpwp_hash(watchpoint->address)];
+	while (*p && *p != watchpoint)
+		p = &(*p)->index_next;
+	if (*p)
+		*p = watchpoint->index_next;
+}
+
+static struct watchpoint *watchpoint_find(struct target *target, target_addr_t address)
+{
+	struct watchpoint *watchpoint;
+
+	if (target->bpwp_index) {
+		watchpoint = target->bpwp_index->watchpoints[bpwp_hash(address)];
+		while (watchpoint && watchpoint->address != address)
+			watchpoint = watchpoint->index_next;
+		return watchpoint;
+	}
+
+	watchpoint = target->watchpoints;
+	while (watchpoint && watchpoint->address != address)
+		watchpoint = watchpoint->next;
+	return watchpoint;
+}
+
 static int breakpoint_add_internal(struct target *target,
 	target_addr_t address,
 	uint32_t length,
 	enum breakpoint_type type)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint *breakpoint;
 	struct breakpoint **breakpoint_p = &target->breakpoints;
 	const char *reason;
 	int retval;
-	int n;
 
-	n = 0;
-	while (breakpoint) {
-		n++;
-		if (breakpoint->address == address) {
-			/* FIXME don't assume "same address" means "same
-			 * breakpoint" ... check all the parameters before
-			 * succeeding.
-			 */
-			LOG_ERROR("Duplicate Breakpoint address: " TARGET_ADDR_FMT " (BP %" PRIu32 ")",
-				address, breakpoint->unique_id);
-			return ERROR_TARGET_DUPLICATE_BREAKPOINT;
-		}
-		breakpoint_p = &breakpoint->next;
-		breakpoint = breakpoint->next;
+	bpwp_index_prepare(target);
+
+	breakpoint = breakpoint_find(target, address);
+	if (breakpoint) {
+		/* FIXME don't assume "same address" means "same
+		 * breakpoint" ... check all the parameters before
+		 * succeeding.
+		 */
+		LOG_ERROR("Duplicate Breakpoint address: " TARGET_ADDR_FMT " (BP %" PRIu32 ")",
+			address, breakpoint->unique_id);
+		return ERROR_TARGET_DUPLICATE_BREAKPOINT;
 	}
 
+	while (*breakpoint_p)
+		breakpoint_p = &(*breakpoint_p)->next;
+
 	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
 	(*breakpoint_p)->address = address;
 	(*breakpoint_p)->asid = 0;
@@ -98,6 +190,8 @@ fail:
 			return retval;
 	}
 
+	breakpoint_index_add(target, *breakpoint_p);
+
 	LOG_DEBUG("added %s breakpoint at " TARGET_ADDR_FMT " of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
 		(*breakpoint_p)->address, (*breakpoint_p)->length,
@@ -116,6 +210,8 @@ static int context_breakpoint_add_internal(struct target *target,
 	int retval;
 	int n;
 
+	bpwp_index_prepare(target);
+
 	n = 0;
 	while (breakpoint) {
 		n++;
@@ -150,6 +246,8 @@ static int context_breakpoint_add_internal(struct target *target,
 		return retval;
 	}
 
+	breakpoint_index_add(target, *breakpoint_p);
+
 	LOG_DEBUG("added %s Context breakpoint at 0x%8.8" PRIx32 " of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
 		(*breakpoint_p)->asid, (*breakpoint_p)->length,
@@ -168,6 +266,9 @@ static int hybrid_breakpoint_add_internal(struct target *target,
 	struct breakpoint **breakpoint_p = &target->breakpoints;
 	int retval;
 	int n;
+
+	bpwp_index_prepare(target);
+
 	n = 0;
 	while (breakpoint) {
 		n++;
@@ -207,6 +308,8 @@ static int hybrid_breakpoint_add_internal(struct target *target,
 		*breakpoint_p = NULL;
 		return retval;
 	}
+
+	breakpoint_index_add(target, *breakpoint_p);
 	LOG_DEBUG(
 		"added %s Hybrid breakpoint at address " TARGET_ADDR_FMT " of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
@@ -307,6 +410,7 @@ static void breakpoint_free(struct target *target, struct breakpoint *breakpoint
 	retval = target_remove_breakpoint(target, breakpoint);
 
 	LOG_DEBUG("free BPID: %" PRIu32 " --> %d", breakpoint->unique_id, retval);
+	breakpoint_index_remove(target, breakpoint);
 	(*breakpoint_p) = breakpoint->next;
 	free(breakpoint->orig_instr);
 	free(breakpoint);
@@ -314,13 +418,27 @@ static void breakpoint_free(struct target *target, struct breakpoint *breakpoint
 
 static int breakpoint_remove_internal(struct target *target, target_addr_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint *breakpoint;
 
-	while (breakpoint) {
-		if ((breakpoint->address == address) ||
-		    (breakpoint->address == 0 && breakpoint->asid == address))
-			break;
-		breakpoint = breakpoint->next;
+	if (target->bpwp_index) {
+		/* the first match in list order, either by address or
+		 * a context breakpoint by asid */
+		breakpoint = breakpoint_find(target, address);
+
+		struct breakpoint *context = target->bpwp_index->breakpoints[bpwp_hash(0)];
+		while (context && !(context->address == 0 && context->asid == address))
+			context = context->index_next;
+
+		if (context && (!breakpoint || context->unique_id < breakpoint->unique_id))
+			breakpoint = context;
+	} else {
+		breakpoint = target->breakpoints;
+		while (breakpoint) {
+			if ((breakpoint->address == address) ||
+			    (breakpoint->address == 0 && breakpoint->asid == address))
+				break;
+			breakpoint = breakpoint->next;
+		}
 	}
 
 	if (breakpoint) {
@@ -404,8 +522,16 @@ void breakpoint_clear_target(struct target *target)
 
 struct breakpoint *breakpoint_find(struct target *target, target_addr_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint *breakpoint;
 
+	if (target->bpwp_index) {
+		breakpoint = target->bpwp_index->breakpoints[bpwp_hash(address)];
+		while (breakpoint && breakpoint->address != address)
+			breakpoint = breakpoint->index_next;
+		return breakpoint;
+	}
+
+	breakpoint = target->breakpoints;
 	while (breakpoint) {
 		if (breakpoint->address == address)
 			return breakpoint;
@@ -418,30 +544,32 @@ struct breakpoint *breakpoint_find(struct target *target, target_addr_t address)
 int watchpoint_add(struct target *target, target_addr_t address, uint32_t length,
 	enum watchpoint_rw rw, uint32_t value, uint32_t mask)
 {
-	struct watchpoint *watchpoint = target->watchpoints;
+	struct watchpoint *watchpoint;
 	struct watchpoint **watchpoint_p = &target->watchpoints;
 	int retval;
 	const char *reason;
 
-	while (watchpoint) {
-		if (watchpoint->address == address) {
-			if (watchpoint->length != length
-				|| watchpoint->value != value
-				|| watchpoint->mask != mask
-				|| watchpoint->rw != rw) {
-				LOG_ERROR("address " TARGET_ADDR_FMT
-					" already has watchpoint %d",
-					address, watchpoint->unique_id);
-				return ERROR_FAIL;
-			}
-
-			/* ignore duplicate watchpoint */
-			return ERROR_OK;
+	bpwp_index_prepare(target);
+
+	watchpoint = watchpoint_find(target, address);
+	if (watchpoint) {
+		if (watchpoint->length != length
+			|| watchpoint->value != value
+			|| watchpoint->mask != mask
+			|| watchpoint->rw != rw) {
+			LOG_ERROR("address " TARGET_ADDR_FMT
+				" already has watchpoint %d",
+				address, watchpoint->unique_id);
+			return ERROR_FAIL;
 		}
-		watchpoint_p = &watchpoint->next;
-		watchpoint = watchpoint->next;
+
+		/* ignore duplicate watchpoint */
+		return ERROR_OK;
 	}
 
+	while (*watchpoint_p)
+		watchpoint_p = &(*watchpoint_p)->next;
+
 	(*watchpoint_p) = calloc(1, sizeof(struct watchpoint));
 	(*watchpoint_p)->address = address;
 	(*watchpoint_p)->length = length;
@@ -471,6 +599,8 @@ bye:
 			return retval;
 	}
 
+	watchpoint_index_add(target, *watchpoint_p);
+
 	LOG_DEBUG("added %s watchpoint at " TARGET_ADDR_FMT
 		" of length 0x%8.8" PRIx32 " (WPID: %d)",
 		watchpoint_rw_strings[(*watchpoint_p)->rw],
@@ -498,19 +628,14 @@ static void watchpoint_free(struct target *target, struct watchpoint *watchpoint
 		return;
 	retval = target_remove_watchpoint(target, watchpoint);
 	LOG_DEBUG("free WPID: %d --> %d", watchpoint->unique_id, retval);
+	watchpoint_index_remove(target, watchpoint);
 	(*watchpoint_p) = watchpoint->next;
 	free(watchpoint);
 }
 
 void watchpoint_remove(struct target *target, target_addr_t address)
 {
-	struct watchpoint *watchpoint = target->watchpoints;
-
-	while (watchpoint) {
-		if (watchpoint->address == address)
-			break;
-		watchpoint = watchpoint->next;
-	}
+	struct watchpoint *watchpoint = watchpoint_find(target, address);
 
 	if (watchpoint)
 		watchpoint_free(target, watchpoint);
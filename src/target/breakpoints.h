@@ -40,6 +40,7 @@ struct breakpoint {
 	int set;
 	uint8_t *orig_instr;
 	struct breakpoint *next;
+	struct breakpoint *index_next;	/* next in the same hash bucket */
 	uint32_t unique_id;
 	int linked_BRP;
 };
@@ -52,9 +53,20 @@ struct watchpoint {
 	enum watchpoint_rw rw;
 	int set;
 	struct watchpoint *next;
+	struct watchpoint *index_next;	/* next in the same hash bucket */
 	int unique_id;
 };
 
+/* number of hash buckets of the per-target breakpoint/watchpoint indexes */
+#define BPWP_INDEX_SIZE 256
+
+struct bpwp_index {
+	struct breakpoint *breakpoints[BPWP_INDEX_SIZE];
+	struct watchpoint *watchpoints[BPWP_INDEX_SIZE];
+};
+
+void bpwp_index_free(struct target *target);
+
 void breakpoint_clear_target(struct target *target);
 int breakpoint_add(struct target *target,
 		target_addr_t address, uint32_t length, enum breakpoint_type type);
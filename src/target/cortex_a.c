@@ -637,22 +637,154 @@ static struct target *get_cortex_a(struct target *target, int32_t coreid)
 }
 static int cortex_a_halt(struct target *target);
 
-static int cortex_a_halt_smp(struct target *target)
+#define CORTEX_A_SMP_MAX_DAPS	8
+
+/*
+ * Flush the debug AP queues of all cores in the SMP group,
+ * running each DAP exactly once.
+ */
+static int cortex_a_smp_run(struct target *target)
 {
-	int retval = 0;
+	struct adiv5_dap *daps[CORTEX_A_SMP_MAX_DAPS];
+	unsigned int num_daps = 0;
 	struct target_list *head;
-	struct target *curr;
-	head = target->head;
-	while (head != (struct target_list *)NULL) {
-		curr = head->target;
-		if ((curr != target) && (curr->state != TARGET_HALTED)
-			&& target_was_examined(curr))
-			retval += cortex_a_halt(curr);
-		head = head->next;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct adiv5_dap *dap = target_to_armv7a(curr)->debug_ap->dap;
+		unsigned int i;
+
+		if (!target_was_examined(curr))
+			continue;
+
+		for (i = 0; i < num_daps; i++)
+			if (daps[i] == dap)
+				break;
+		if (i < num_daps)
+			continue;
+
+		if (num_daps < CORTEX_A_SMP_MAX_DAPS) {
+			daps[num_daps++] = dap;
+		} else {
+			int run_retval = dap_run(dap);
+			if (retval == ERROR_OK)
+				retval = run_retval;
+		}
 	}
+
+	for (unsigned int i = 0; i < num_daps; i++) {
+		int run_retval = dap_run(daps[i]);
+		if (retval == ERROR_OK)
+			retval = run_retval;
+	}
+
 	return retval;
 }
 
+/*
+ * Wait until all selected cores of the SMP group report the given
+ * DSCR bits, reading the DSCR of all of them with a single flush.
+ */
+static int cortex_a_smp_wait_dscr_bits(struct target *target, uint32_t mask, uint32_t value)
+{
+	struct target_list *head;
+	int retval;
+
+	int64_t then = timeval_ms();
+	for (;;) {
+		struct target *pending = NULL;
+
+		retval = ERROR_OK;
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
+			struct cortex_a_common *cortex_a = target_to_cortex_a(curr);
+			struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+			if (!cortex_a->smp_selected)
+				continue;
+
+			retval = mem_ap_read_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_DSCR, &cortex_a->smp_dscr);
+			if (retval != ERROR_OK)
+				break;
+		}
+
+		int run_retval = cortex_a_smp_run(target);
+		if (retval == ERROR_OK)
+			retval = run_retval;
+		if (retval != ERROR_OK)
+			return retval;
+
+		foreach_smp_target(head, target->head) {
+			struct target *curr = head->target;
+			struct cortex_a_common *cortex_a = target_to_cortex_a(curr);
+
+			if (cortex_a->smp_selected && (cortex_a->smp_dscr & mask) != value) {
+				pending = curr;
+				break;
+			}
+		}
+
+		if (pending == NULL)
+			return ERROR_OK;
+
+		if (timeval_ms() > then + 1000) {
+			LOG_ERROR("Timeout waiting for DSCR bit change on %s", target_name(pending));
+			return ERROR_TARGET_TIMEOUT;
+		}
+	}
+}
+
+static int cortex_a_halt_smp(struct target *target)
+{
+	int retval = ERROR_OK;
+	struct target_list *head;
+	unsigned int selected = 0;
+
+	/* request a halt of all other cores with a single flush */
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct cortex_a_common *cortex_a = target_to_cortex_a(curr);
+		struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+		cortex_a->smp_selected = (curr != target) && (curr->state != TARGET_HALTED)
+			&& target_was_examined(curr);
+		if (!cortex_a->smp_selected)
+			continue;
+
+		selected++;
+		retval = mem_ap_write_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DRCR, DRCR_HALT);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	if (!selected)
+		return retval;
+
+	int run_retval = cortex_a_smp_run(target);
+	if (retval == ERROR_OK)
+		retval = run_retval;
+
+	/* then wait for all of them to be halted */
+	if (retval == ERROR_OK)
+		retval = cortex_a_smp_wait_dscr_bits(target, DSCR_CORE_HALTED, DSCR_CORE_HALTED);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error waiting for halt");
+		return retval;
+	}
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+
+		if (target_to_cortex_a(curr)->smp_selected)
+			curr->debug_reason = DBG_REASON_DBGRQ;
+	}
+
+	return ERROR_OK;
+}
+
 static int update_halt_gdb(struct target *target)
 {
 	struct target *gdb_target = NULL;
@@ -699,6 +831,21 @@ static int update_halt_gdb(struct target *target)
  * Cortex-A Run control
  */
 
+static int cortex_a_poll_queue(struct target *target)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+	int retval = mem_ap_read_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_DSCR, &cortex_a->cpudbg_dscr_queued);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cortex_a->cpudbg_dscr_is_queued = true;
+	cortex_a->cpudbg_dscr_queued_at = armv7a->debug_ap->dap->run_count;
+	return ERROR_OK;
+}
+
 static int cortex_a_poll(struct target *target)
 {
 	int retval = ERROR_OK;
@@ -718,8 +865,16 @@ static int cortex_a_poll(struct target *target)
 		target_call_event_callbacks(target, TARGET_EVENT_HALTED);
 		return retval;
 	}
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DSCR, &dscr);
+	/* possibly through the flush shared with other cores on this DAP */
+	retval = ERROR_FAIL;
+	if (cortex_a->cpudbg_dscr_is_queued && target->poll_due) {
+		retval = dap_run_queued(armv7a->debug_ap->dap, cortex_a->cpudbg_dscr_queued_at);
+		dscr = cortex_a->cpudbg_dscr_queued;
+	}
+	cortex_a->cpudbg_dscr_is_queued = false;
+	if (retval != ERROR_OK)
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DSCR, &dscr);
 	if (retval != ERROR_OK)
 		return retval;
 	cortex_a->cpudbg_dscr = dscr;
@@ -934,24 +1089,91 @@ static int cortex_a_internal_restart(struct target *target)
 
 static int cortex_a_restore_smp(struct target *target, int handle_breakpoints)
 {
-	int retval = 0;
+	int retval = ERROR_OK;
 	struct target_list *head;
-	struct target *curr;
 	target_addr_t address;
-	head = target->head;
-	while (head != (struct target_list *)NULL) {
-		curr = head->target;
-		if ((curr != target) && (curr->state != TARGET_RUNNING)
-			&& target_was_examined(curr)) {
-			/*  resume current address , not in step mode */
-			retval += cortex_a_internal_restore(curr, 1, &address,
-					handle_breakpoints, 0);
-			retval += cortex_a_internal_restart(curr);
-		}
-		head = head->next;
+	unsigned int selected = 0;
+
+	/* restore the context of all other cores first */
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct cortex_a_common *cortex_a = target_to_cortex_a(curr);
+		struct armv7a_common *armv7a = &cortex_a->armv7a_common;
 
+		cortex_a->smp_selected = (curr != target) && (curr->state != TARGET_RUNNING)
+			&& target_was_examined(curr);
+		if (!cortex_a->smp_selected)
+			continue;
+
+		/*  resume current address , not in step mode */
+		retval = cortex_a_internal_restore(curr, 1, &address,
+				handle_breakpoints, 0);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_DSCR, &cortex_a->smp_dscr);
+		if (retval != ERROR_OK)
+			return retval;
+		selected++;
 	}
-	return retval;
+
+	if (!selected)
+		return ERROR_OK;
+
+	retval = cortex_a_smp_run(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/*
+	 * Restart all of them together: clear ITRen and sticky exception
+	 * flags, see ARMv7 ARM, C5.9, then wait for all to be started.
+	 */
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct cortex_a_common *cortex_a = target_to_cortex_a(curr);
+		struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+
+		if (!cortex_a->smp_selected)
+			continue;
+
+		if ((cortex_a->smp_dscr & DSCR_INSTR_COMP) == 0)
+			LOG_ERROR("%s: DSCR InstrCompl must be set before leaving debug!",
+					target_name(curr));
+
+		retval = mem_ap_write_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DSCR, cortex_a->smp_dscr & ~DSCR_ITR_EN);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_DRCR, DRCR_RESTART |
+					DRCR_CLEAR_EXCEPTIONS);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	int run_retval = cortex_a_smp_run(target);
+	if (retval == ERROR_OK)
+		retval = run_retval;
+
+	if (retval == ERROR_OK)
+		retval = cortex_a_smp_wait_dscr_bits(target, DSCR_CORE_RESTARTED, DSCR_CORE_RESTARTED);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error waiting for resume");
+		return retval;
+	}
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+
+		if (!target_to_cortex_a(curr)->smp_selected)
+			continue;
+
+		curr->debug_reason = DBG_REASON_NOTHALTED;
+		curr->state = TARGET_RUNNING;
+
+		/* registers are now invalid */
+		register_cache_invalidate(target_to_arm(curr)->core_cache);
+	}
+
+	return ERROR_OK;
 }
 
 static int cortex_a_resume(struct target *target, int current,
@@ -2673,15 +2895,12 @@ static int cortex_a_handle_target_request(void *priv)
  * Cortex-A target information and configuration
  */
 
-static int cortex_a_examine_first(struct target *target)
+static int cortex_a_examine_ap(struct target *target)
 {
 	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
 	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
 	struct adiv5_dap *swjdp = armv7a->arm.dap;
-
-	int i;
-	int retval = ERROR_OK;
-	uint32_t didr, cpuid, dbg_osreg, dbg_idpfr1;
+	int retval;
 
 	/* Search for the APB-AP - it is needed for access to debug registers */
 	retval = dap_find_ap(swjdp, AP_TYPE_APB_AP, &armv7a->debug_ap);
@@ -2725,18 +2944,85 @@ static int cortex_a_examine_first(struct target *target)
 		LOG_WARNING("Debug base address for target %s has bit 31 set to 0. Access to debug registers will likely fail!\n"
 			    "Please fix the target configuration.", target_name(target));
 
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DIDR, &didr);
-	if (retval != ERROR_OK) {
-		LOG_DEBUG("Examine %s failed", "DIDR");
+	return ERROR_OK;
+}
+
+static int cortex_a_examine_queue(struct target *target)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+	const struct {
+		uint32_t offset;
+		uint32_t *value;
+	} regs[] = {
+		{ CPUDBG_DIDR, &cortex_a->examine_didr },
+		{ CPUDBG_CPUID, &cortex_a->examine_cpuid },
+		{ CPUDBG_PRSR, &cortex_a->examine_prsr },
+		{ CPUDBG_OSLSR, &cortex_a->examine_oslsr },
+		{ CPUDBG_ID_PFR1, &cortex_a->examine_idpfr1 },
+	};
+	int retval;
+
+	cortex_a->examine_is_queued = false;
+
+	retval = cortex_a_examine_ap(target);
+	if (retval != ERROR_OK)
 		return retval;
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(regs); i++) {
+		retval = mem_ap_read_u32(armv7a->debug_ap,
+				armv7a->debug_base + regs[i].offset, regs[i].value);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_CPUID, &cpuid);
-	if (retval != ERROR_OK) {
-		LOG_DEBUG("Examine %s failed", "CPUID");
-		return retval;
+	cortex_a->examine_is_queued = true;
+	cortex_a->examine_queued_at = armv7a->debug_ap->dap->run_count;
+	return ERROR_OK;
+}
+
+static int cortex_a_examine_first(struct target *target)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+	struct adiv5_dap *swjdp = armv7a->arm.dap;
+
+	int i;
+	int retval = ERROR_OK;
+	uint32_t didr, cpuid, dbg_osreg, dbg_idpfr1;
+	bool queued = cortex_a->examine_is_queued;
+
+	cortex_a->examine_is_queued = false;
+	if (!queued) {
+		retval = cortex_a_examine_ap(target);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	/*
+	 * Use the reads cortex_a_examine_queue() left in the queue; if that
+	 * flush failed, read again one by one to find out what went wrong.
+	 */
+	if (queued && dap_run_queued(armv7a->debug_ap->dap, cortex_a->examine_queued_at) != ERROR_OK)
+		queued = false;
+
+	if (queued) {
+		didr = cortex_a->examine_didr;
+		cpuid = cortex_a->examine_cpuid;
+	} else {
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DIDR, &didr);
+		if (retval != ERROR_OK) {
+			LOG_DEBUG("Examine %s failed", "DIDR");
+			return retval;
+		}
+
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_CPUID, &cpuid);
+		if (retval != ERROR_OK) {
+			LOG_DEBUG("Examine %s failed", "CPUID");
+			return retval;
+		}
 	}
 
 	LOG_DEBUG("didr = 0x%08" PRIx32, didr);
@@ -2745,10 +3031,38 @@ static int cortex_a_examine_first(struct target *target)
 	cortex_a->didr = didr;
 	cortex_a->cpuid = cpuid;
 
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-				    armv7a->debug_base + CPUDBG_PRSR, &dbg_osreg);
-	if (retval != ERROR_OK)
-		return retval;
+	/* Locate the PC sampling register: v7.1 debug advertises it at 0x0A0
+	 * through DBGDEVID.PCsample, older cores through DBGDIDR.PCSR_imp */
+	cortex_a->pcsr = 0;
+	cortex_a->pcsr_offset_applied = true;
+	if (didr & (1 << 15)) {
+		uint32_t devid, devid1;
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DEVID, &devid);
+		if (retval == ERROR_OK && (devid & 0xf) != 0) {
+			cortex_a->pcsr = CPUDBG_PCSR;
+			retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_DEVID1, &devid1);
+			if (retval == ERROR_OK)
+				cortex_a->pcsr_offset_applied = (devid1 & 0xf) == 0;
+		}
+		if (retval != ERROR_OK) {
+			LOG_DEBUG("Examine %s failed", "DEVID");
+			return retval;
+		}
+	}
+	if (cortex_a->pcsr == 0 && (didr & (1 << 13)))
+		cortex_a->pcsr = CPUDBG_PCSR_R33;
+	LOG_DEBUG("pcsr at 0x%03" PRIx32, cortex_a->pcsr);
+
+	if (queued) {
+		dbg_osreg = cortex_a->examine_prsr;
+	} else {
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+					    armv7a->debug_base + CPUDBG_PRSR, &dbg_osreg);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 	LOG_DEBUG("target->coreid %" PRId32 " DBGPRSR  0x%" PRIx32, target->coreid, dbg_osreg);
 
 	if ((dbg_osreg & PRSR_POWERUP_STATUS) == 0) {
@@ -2761,10 +3075,14 @@ static int cortex_a_examine_first(struct target *target)
 		LOG_DEBUG("target->coreid %" PRId32 " was reset!", target->coreid);
 
 	/* Read DBGOSLSR and check if OSLK is implemented */
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-				armv7a->debug_base + CPUDBG_OSLSR, &dbg_osreg);
-	if (retval != ERROR_OK)
-		return retval;
+	if (queued) {
+		dbg_osreg = cortex_a->examine_oslsr;
+	} else {
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+					armv7a->debug_base + CPUDBG_OSLSR, &dbg_osreg);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 	LOG_DEBUG("target->coreid %" PRId32 " DBGOSLSR 0x%" PRIx32, target->coreid, dbg_osreg);
 
 	/* check if OS Lock is implemented */
@@ -2790,10 +3108,14 @@ static int cortex_a_examine_first(struct target *target)
 		}
 	}
 
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-				 armv7a->debug_base + CPUDBG_ID_PFR1, &dbg_idpfr1);
-	if (retval != ERROR_OK)
-		return retval;
+	if (queued) {
+		dbg_idpfr1 = cortex_a->examine_idpfr1;
+	} else {
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+					 armv7a->debug_base + CPUDBG_ID_PFR1, &dbg_idpfr1);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 
 	if (dbg_idpfr1 & 0x000000f0) {
 		LOG_DEBUG("target->coreid %" PRId32 " has security extensions",
@@ -2862,6 +3184,100 @@ static int cortex_a_examine(struct target *target)
  *	Cortex-A target creation and initialization
  */
 
+/* Number of DBGPCSR reads queued per DAP run while profiling */
+#define CORTEX_A_PCSR_BATCH	1024
+
+/* DBGPCSR reads as all ones in debug state or when sampling is prohibited */
+#define CORTEX_A_PCSR_INVALID	0xFFFFFFFF
+
+static uint32_t cortex_a_pcsr_to_pc(struct cortex_a_common *cortex_a, uint32_t pcsr)
+{
+	/* bit 0 set means Thumb state, bits [1:0] clear means ARM state */
+	if (pcsr & 1)
+		return (pcsr & ~1u) - (cortex_a->pcsr_offset_applied ? 4 : 0);
+	return (pcsr & ~3u) - (cortex_a->pcsr_offset_applied ? 8 : 0);
+}
+
+static int cortex_a_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+	struct timeval timeout, now;
+	int retval = ERROR_OK;
+
+	if (cortex_a->pcsr == 0) {
+		LOG_INFO("PCSR sampling not supported on this processor.");
+		return target_profiling_default(target, samples, max_num_samples, num_samples, seconds);
+	}
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	LOG_DEBUG("Starting Cortex-A/R profiling. Sampling DBGPCSR as fast as we can...");
+
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED)
+		retval = target_resume(target, 1, 0, 0, 0);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error while resuming target");
+		return retval;
+	}
+
+	uint8_t *buffer = malloc(CORTEX_A_PCSR_BATCH * 4);
+	if (buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	uint32_t sample_count = 0;
+
+	for (;;) {
+		uint32_t read_count = max_num_samples - sample_count;
+		if (read_count > CORTEX_A_PCSR_BATCH)
+			read_count = CORTEX_A_PCSR_BATCH;
+
+		retval = mem_ap_read_buf_noincr(armv7a->debug_ap, buffer, 4, read_count,
+				armv7a->debug_base + cortex_a->pcsr);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while reading PCSR");
+			break;
+		}
+
+		uint32_t valid = 0;
+		for (uint32_t i = 0; i < read_count; i++) {
+			uint32_t pcsr = le_to_h_u32(buffer + 4 * i);
+			if (pcsr != CORTEX_A_PCSR_INVALID)
+				samples[sample_count + valid++] = cortex_a_pcsr_to_pc(cortex_a, pcsr);
+		}
+		sample_count += valid;
+
+		/* A batch without a single valid sample means the core stopped;
+		 * stop early if it is no longer running at all. */
+		if (valid == 0) {
+			retval = target_poll(target);
+			if (retval != ERROR_OK)
+				break;
+			if (target->state != TARGET_RUNNING) {
+				LOG_INFO("Target not running, profiling stopped");
+				break;
+			}
+		}
+
+		gettimeofday(&now, NULL);
+		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
+			LOG_DEBUG("Profiling completed. %" PRIu32 " samples.", sample_count);
+			break;
+		}
+	}
+
+	free(buffer);
+	*num_samples = sample_count;
+	return retval;
+}
+
 static int cortex_a_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -3146,6 +3562,7 @@ struct target_type cortexa_target = {
 	.deprecated_name = "cortex_a8",
 
 	.poll = cortex_a_poll,
+	.poll_queue = cortex_a_poll_queue,
 	.arch_state = armv7a_arch_state,
 
 	.halt = cortex_a_halt,
@@ -3167,6 +3584,7 @@ struct target_type cortexa_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
@@ -3177,11 +3595,14 @@ struct target_type cortexa_target = {
 	.add_watchpoint = NULL,
 	.remove_watchpoint = NULL,
 
+	.profiling = cortex_a_profiling,
+
 	.commands = cortex_a_command_handlers,
 	.target_create = cortex_a_target_create,
 	.target_jim_configure = adiv5_jim_configure,
 	.init_target = cortex_a_init_target,
 	.examine = cortex_a_examine,
+	.examine_queue = cortex_a_examine_queue,
 	.deinit_target = cortex_a_deinit_target,
 
 	.read_phys_memory = cortex_a_read_phys_memory,
@@ -3226,6 +3647,7 @@ struct target_type cortexr4_target = {
 	.name = "cortex_r4",
 
 	.poll = cortex_a_poll,
+	.poll_queue = cortex_a_poll_queue,
 	.arch_state = armv7a_arch_state,
 
 	.halt = cortex_a_halt,
@@ -3244,6 +3666,7 @@ struct target_type cortexr4_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
@@ -3254,10 +3677,13 @@ struct target_type cortexr4_target = {
 	.add_watchpoint = NULL,
 	.remove_watchpoint = NULL,
 
+	.profiling = cortex_a_profiling,
+
 	.commands = cortex_r4_command_handlers,
 	.target_create = cortex_r4_target_create,
 	.target_jim_configure = adiv5_jim_configure,
 	.init_target = cortex_a_init_target,
 	.examine = cortex_a_examine,
+	.examine_queue = cortex_a_examine_queue,
 	.deinit_target = cortex_a_deinit_target,
 };
@@ -76,6 +76,23 @@ struct cortex_a_common {
 
 	/* Context information */
 	uint32_t cpudbg_dscr;
+	/* DSCR read queued by cortex_a_poll_queue(), consumed by the next poll */
+	uint32_t cpudbg_dscr_queued;
+	bool cpudbg_dscr_is_queued;
+	unsigned int cpudbg_dscr_queued_at;
+
+	/* scratch for the batched SMP halt/restart sequences */
+	uint32_t smp_dscr;
+	bool smp_selected;
+
+	/* identification reads queued by cortex_a_examine_queue() */
+	uint32_t examine_didr;
+	uint32_t examine_cpuid;
+	uint32_t examine_prsr;
+	uint32_t examine_oslsr;
+	uint32_t examine_idpfr1;
+	bool examine_is_queued;
+	unsigned int examine_queued_at;
 
 	/* Saved cp15 registers */
 	uint32_t cp15_control_reg;
@@ -96,6 +113,11 @@ struct cortex_a_common {
 	uint32_t cpuid;
 	uint32_t didr;
 
+	/* PC sampling register offset from debug_base, 0 if not implemented */
+	uint32_t pcsr;
+	/* sampled PC includes the +8/+4 pipeline offset */
+	bool pcsr_offset_applied;
+
 	enum cortex_a_isrmasking_mode isrmasking_mode;
 	enum cortex_a_dacrfixup_mode dacrfixup_mode;
 
@@ -477,6 +477,313 @@ static int cortex_m_examine_exception_reason(struct target *target)
 	return retval;
 }
 
+/* DCRSR register selector of an armv7m register, -1 if there is none */
+static int cortex_m_dcrsr_regsel(int num)
+{
+	switch (num) {
+		case ARMV7M_R0 ... ARMV7M_PSP:
+			return num;
+		case ARMV7M_PRIMASK ... ARMV7M_CONTROL:
+			/* one Debug Core Register for all four */
+			return 20;
+		case ARMV7M_S0 ... ARMV7M_S31:
+			return num - ARMV7M_S0 + 0x40;
+		case ARMV7M_FPSCR:
+			return 0x21;
+		default:
+			return -1;
+	}
+}
+
+#define CORTEX_M_NUM_REGSEL 0x60
+
+/* registers debug entry, resume, semihosting and the halt banner
+ * (armv7m_arch_state) use right after a halt */
+static bool cortex_m_reg_needed_on_halt(int num)
+{
+	switch (num) {
+		case ARMV7M_R0:
+		case ARMV7M_R1:
+		case ARMV7M_R13:
+		case ARMV7M_PC:
+		case ARMV7M_xPSR:
+		case ARMV7M_PRIMASK ... ARMV7M_CONTROL:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Read invalid core registers in one DAP run: for each Debug Core
+ * Register a DCRSR write immediately followed by the DCRDR read.  The
+ * transfer completes in a few core cycles, far less than the DAP takes
+ * to issue the next access, so S_REGRDY is only checked once, after the
+ * last transfer.  Returns an error without touching the register cache
+ * if that check fails, callers then read registers one by one.
+ * Unless @a all is set only the registers needed to handle a halt are
+ * read, the others stay invalid until first accessed.
+ */
+static int cortex_m_read_core_regs(struct target *target, bool all)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct reg_cache *cache = armv7m->arm.core_cache;
+	uint32_t values[CORTEX_M_NUM_REGSEL];
+	bool wanted[CORTEX_M_NUM_REGSEL] = { false };
+	uint32_t dcrdr = 0, dhcsr;
+	int retval;
+
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		struct reg *r = &cache->reg_list[i];
+		struct arm_reg *arm_reg = r->arch_info;
+
+		if (r->valid || (!all && !cortex_m_reg_needed_on_halt(arm_reg->num)))
+			continue;
+
+		if (arm_reg->num >= ARMV7M_D0 && arm_reg->num <= ARMV7M_D15) {
+			int s = 0x40 + 2 * (arm_reg->num - ARMV7M_D0);
+			wanted[s] = wanted[s + 1] = true;
+			continue;
+		}
+
+		int regsel = cortex_m_dcrsr_regsel(arm_reg->num);
+		if (regsel < 0)
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		wanted[regsel] = true;
+	}
+
+	/* DCRDR doubles as the emulated dcc channel, keep its contents */
+	if (target->dbg_msg_enabled) {
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (int regsel = 0; regsel < CORTEX_M_NUM_REGSEL; regsel++) {
+		if (!wanted[regsel])
+			continue;
+		retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRSR, regsel);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &values[regsel]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &dhcsr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (target->dbg_msg_enabled) {
+		/* restore DCB_DCRDR - this needs to be in a separate
+		 * transaction otherwise the emulated DCC channel breaks */
+		retval = mem_ap_write_atomic_u32(armv7m->debug_ap, DCB_DCRDR, dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (!(dhcsr & S_REGRDY)) {
+		LOG_DEBUG("core register transfer not ready, reading registers one by one");
+		return ERROR_TARGET_TIMEOUT;
+	}
+
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		struct reg *r = &cache->reg_list[i];
+		struct arm_reg *arm_reg = r->arch_info;
+		int num = arm_reg->num;
+
+		if (r->valid || (!all && !cortex_m_reg_needed_on_halt(num)))
+			continue;
+
+		if (num >= ARMV7M_D0 && num <= ARMV7M_D15) {
+			int s = 0x40 + 2 * (num - ARMV7M_D0);
+			buf_set_u32(r->value, 0, 32, values[s]);
+			buf_set_u32(r->value + 4, 0, 32, values[s + 1]);
+		} else {
+			int regsel = cortex_m_dcrsr_regsel(num);
+			if (regsel < 0)
+				continue;
+			uint32_t value = values[regsel];
+
+			switch (num) {
+				case ARMV7M_PRIMASK:
+					value = buf_get_u32((uint8_t *)&value, 0, 1);
+					break;
+				case ARMV7M_BASEPRI:
+					value = buf_get_u32((uint8_t *)&value, 8, 8);
+					break;
+				case ARMV7M_FAULTMASK:
+					value = buf_get_u32((uint8_t *)&value, 16, 1);
+					break;
+				case ARMV7M_CONTROL:
+					value = buf_get_u32((uint8_t *)&value, 24, 3);
+					break;
+			}
+			buf_set_u32(r->value, 0, 32, value);
+		}
+
+		r->valid = true;
+		r->dirty = false;
+	}
+
+	return ERROR_OK;
+}
+
+static int cortex_m_load_core_regs(struct target *target)
+{
+	return cortex_m_read_core_regs(target, true);
+}
+
+static int cortex_m_compare_breakpoints(const void *a, const void *b)
+{
+	const struct breakpoint *ba = *(const struct breakpoint **)a;
+	const struct breakpoint *bb = *(const struct breakpoint **)b;
+
+	if (ba->address < bb->address)
+		return -1;
+	return ba->address > bb->address;
+}
+
+/*
+ * Whether software breakpoints can be written all at once through queued
+ * MEM-AP accesses. Not through HLA adapters or on big endian cores; those
+ * keep their software breakpoints in memory while halted and set each one
+ * as it is added.
+ */
+static bool cortex_m_sw_breakpoints_batched(struct target *target)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	return !armv7m->stlink && armv7m->debug_ap != NULL
+			&& target->endianness == TARGET_LITTLE_ENDIAN;
+}
+
+/*
+ * Set (or restore the original instructions of) all pending software
+ * breakpoints with one queued read and one queued write per memory word
+ * instead of a read and a write round-trip per breakpoint.  Breakpoints
+ * sharing a word are merged so they don't overwrite each other.
+ */
+static int cortex_m_write_sw_breakpoints(struct target *target, bool set)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct breakpoint **list;
+	uint32_t *words, *orig;
+	unsigned int count = 0, num_words = 0;
+	int retval;
+
+	if (!cortex_m_sw_breakpoints_batched(target))
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	for (struct breakpoint *b = target->breakpoints; b; b = b->next) {
+		if (b->type == BKPT_SOFT && b->length == 2 && !b->set == set)
+			count++;
+	}
+	if (count == 0)
+		return ERROR_OK;
+
+	list = malloc(count * sizeof(*list));
+	words = malloc(count * sizeof(*words));
+	orig = malloc(count * sizeof(*orig));
+	if (list == NULL || words == NULL || orig == NULL) {
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	count = 0;
+	for (struct breakpoint *b = target->breakpoints; b; b = b->next) {
+		if (b->type == BKPT_SOFT && b->length == 2 && !b->set == set)
+			list[count++] = b;
+	}
+	qsort(list, count, sizeof(*list), cortex_m_compare_breakpoints);
+
+	for (unsigned int i = 0; i < count; i++) {
+		uint32_t word = list[i]->address & ~3u;
+		if (num_words == 0 || words[num_words - 1] != word)
+			words[num_words++] = word;
+	}
+
+	for (unsigned int i = 0; i < num_words; i++) {
+		retval = mem_ap_read_u32(armv7m->debug_ap, words[i], &orig[i]);
+		if (retval != ERROR_OK)
+			goto done;
+	}
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		goto done;
+
+	unsigned int w = 0;
+	uint32_t value = orig[0];
+	for (unsigned int i = 0; i < count; i++) {
+		struct breakpoint *b = list[i];
+		unsigned int shift = (b->address & 2) ? 16 : 0;
+
+		if ((b->address & ~3u) != words[w]) {
+			retval = mem_ap_write_u32(armv7m->debug_ap, words[w], value);
+			if (retval != ERROR_OK)
+				goto done;
+			w++;
+			value = orig[w];
+		}
+
+		uint16_t instr;
+		if (set) {
+			/* orig_instr is kept in target endianness */
+			target_buffer_set_u16(target, b->orig_instr, value >> shift);
+			instr = ARMV5_T_BKPT(0x11) & 0xffff;
+		} else {
+			instr = target_buffer_get_u16(target, b->orig_instr);
+		}
+		value = (value & ~(0xffffu << shift)) | ((uint32_t)instr << shift);
+	}
+	retval = mem_ap_write_u32(armv7m->debug_ap, words[w], value);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv7m->debug_ap->dap);
+
+	if (retval != ERROR_OK) {
+		/* don't leave BKPT instructions the breakpoints don't know about */
+		if (set) {
+			for (unsigned int i = 0; i < num_words; i++)
+				mem_ap_write_u32(armv7m->debug_ap, words[i], orig[i]);
+			dap_run(armv7m->debug_ap->dap);
+		}
+		goto done;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+		list[i]->set = set;
+
+	LOG_DEBUG("%s %u software breakpoints in %u words", set ? "set" : "restored",
+			count, num_words);
+
+done:
+	free(orig);
+	free(words);
+	free(list);
+	return retval;
+}
+
+/* restore the original instructions under all software breakpoints,
+ * they are set again by the next resume */
+static void cortex_m_restore_sw_breakpoints(struct target *target)
+{
+	/* without batching, breakpoints stay set while halted */
+	if (!cortex_m_sw_breakpoints_batched(target))
+		return;
+
+	if (cortex_m_write_sw_breakpoints(target, false) == ERROR_OK)
+		return;
+
+	for (struct breakpoint *b = target->breakpoints; b; b = b->next) {
+		if (b->type == BKPT_SOFT && b->set)
+			cortex_m_unset_breakpoint(target, b);
+	}
+}
+
 static int cortex_m_debug_entry(struct target *target)
 {
 	int i;
@@ -518,7 +825,8 @@ static int cortex_m_debug_entry(struct target *target)
 	 * First load register accessible through core debug port */
 	int num_regs = arm->core_cache->num_regs;
 
-	for (i = 0; i < num_regs; i++) {
+	retval = cortex_m_read_core_regs(target, arm->eager_reg_fetch);
+	for (i = 0; i < num_regs && retval != ERROR_OK; i++) {
 		r = &armv7m->arm.core_cache->reg_list[i];
 		if (!r->valid)
 			arm->read_core_reg(target, r, i, ARM_MODE_ANY);
@@ -560,6 +868,8 @@ static int cortex_m_debug_entry(struct target *target)
 	if (armv7m->exception_number)
 		cortex_m_examine_exception_reason(target);
 
+	cortex_m_restore_sw_breakpoints(target);
+
 	LOG_DEBUG("entered debug state in core mode: %s at PC 0x%" PRIx32 ", cpu in %s state, target->state: %s",
 		arm_mode_name(arm->core_mode),
 		buf_get_u32(arm->pc->value, 0, 32),
@@ -575,20 +885,57 @@ static int cortex_m_debug_entry(struct target *target)
 	return ERROR_OK;
 }
 
+static int cortex_m_poll_queue(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = &cortex_m->armv7m;
+
+	if (cortex_m->dcb_dhcsr_is_queued) {
+		/* still waiting for a flush, so it is as recent as a new read */
+		if (armv7m->debug_ap->dap->run_count == cortex_m->dcb_dhcsr_queued_at)
+			return ERROR_OK;
+		/* reading DHCSR cleared its sticky bits, don't lose them */
+		cortex_m->dcb_dhcsr_sticky |= cortex_m->dcb_dhcsr_queued & S_RESET_ST;
+	}
+
+	cortex_m->dcb_dhcsr_queued = 0;
+	int retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr_queued);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cortex_m->dcb_dhcsr_is_queued = true;
+	cortex_m->dcb_dhcsr_queued_at = armv7m->debug_ap->dap->run_count;
+	return ERROR_OK;
+}
+
 static int cortex_m_poll(struct target *target)
 {
 	int detected_failure = ERROR_OK;
-	int retval = ERROR_OK;
+	int retval = ERROR_FAIL;
 	enum target_state prev_target_state = target->state;
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = &cortex_m->armv7m;
 
-	/* Read from Debug Halting Control and Status Register */
-	retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+	/* Read from Debug Halting Control and Status Register, possibly
+	 * through the flush shared with other cores on this DAP */
+	if (cortex_m->dcb_dhcsr_is_queued && target->poll_due) {
+		retval = dap_run_queued(armv7m->debug_ap->dap, cortex_m->dcb_dhcsr_queued_at);
+		if (retval == ERROR_OK)
+			cortex_m->dcb_dhcsr = cortex_m->dcb_dhcsr_queued;
+	}
+	if (retval != ERROR_OK) {
+		/* the atomic read also flushes a queued read still pending */
+		retval = mem_ap_read_atomic_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+		if (retval == ERROR_OK && cortex_m->dcb_dhcsr_is_queued)
+			cortex_m->dcb_dhcsr_sticky |= cortex_m->dcb_dhcsr_queued & S_RESET_ST;
+	}
+	cortex_m->dcb_dhcsr_is_queued = false;
 	if (retval != ERROR_OK) {
 		target->state = TARGET_UNKNOWN;
 		return retval;
 	}
+	cortex_m->dcb_dhcsr |= cortex_m->dcb_dhcsr_sticky;
+	cortex_m->dcb_dhcsr_sticky = 0;
 
 	/* Recover from lockup.  See ARMv7-M architecture spec,
 	 * section B1.5.15 "Unrecoverable exception cases".
@@ -786,16 +1133,30 @@ static int cortex_m_soft_reset_halt(struct target *target)
 	return ERROR_OK;
 }
 
-void cortex_m_enable_breakpoints(struct target *target)
+int cortex_m_enable_breakpoints(struct target *target)
 {
 	struct breakpoint *breakpoint = target->breakpoints;
+	int retval = ERROR_OK;
+
+	/* software breakpoints first, all at once if possible; if that
+	 * fails, the loop below finds the breakpoint that can't be set */
+	cortex_m_write_sw_breakpoints(target, true);
 
 	/* set any pending breakpoints */
 	while (breakpoint) {
-		if (!breakpoint->set)
-			cortex_m_set_breakpoint(target, breakpoint);
+		if (!breakpoint->set) {
+			int retval2 = cortex_m_set_breakpoint(target, breakpoint);
+			if (retval2 != ERROR_OK) {
+				LOG_ERROR("can't set breakpoint at address " TARGET_ADDR_FMT,
+						breakpoint->address);
+				if (retval == ERROR_OK)
+					retval = retval2;
+			}
+		}
 		breakpoint = breakpoint->next;
 	}
+
+	return retval;
 }
 
 static int cortex_m_resume(struct target *target, int current,
@@ -813,7 +1174,11 @@ static int cortex_m_resume(struct target *target, int current,
 
 	if (!debug_execution) {
 		target_free_all_working_areas(target);
-		cortex_m_enable_breakpoints(target);
+		int retval = cortex_m_enable_breakpoints(target);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("not resuming, breakpoints could not be set");
+			return retval;
+		}
 		cortex_m_enable_watchpoints(target);
 	}
 
@@ -924,7 +1289,7 @@ static int cortex_m_step(struct target *target, int current,
 	/* the front-end may request us not to handle breakpoints */
 	if (handle_breakpoints) {
 		breakpoint = breakpoint_find(target, pc_value);
-		if (breakpoint)
+		if (breakpoint && breakpoint->set)
 			cortex_m_unset_breakpoint(target, breakpoint);
 	}
 
@@ -1011,6 +1376,9 @@ static int cortex_m_step(struct target *target, int current,
 					cortex_m_write_debug_halt_mask(target, C_HALT, 0);
 					cortex_m_set_maskints_for_halt(target);
 				} else {
+					/* the handlers run with all breakpoints */
+					cortex_m_enable_breakpoints(target);
+
 					/* Start the core */
 					LOG_DEBUG("Starting core to serve pending interrupts");
 					int64_t t_start = timeval_ms();
@@ -1402,6 +1770,20 @@ int cortex_m_add_breakpoint(struct target *target, struct breakpoint *breakpoint
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
 
+	/* while halted, software breakpoints are only written to memory by
+	 * the next resume, together with all others; make sure now that
+	 * there is memory at the address */
+	if (breakpoint->type == BKPT_SOFT && target->state == TARGET_HALTED
+			&& cortex_m_sw_breakpoints_batched(target)) {
+		uint8_t instr[2];
+		int retval = target_read_memory(target, breakpoint->address & 0xFFFFFFFE,
+				breakpoint->length, 1, instr);
+		if (retval != ERROR_OK)
+			LOG_ERROR("can't access breakpoint address " TARGET_ADDR_FMT,
+					breakpoint->address);
+		return retval;
+	}
+
 	return cortex_m_set_breakpoint(target, breakpoint);
 }
 
@@ -1829,6 +2211,12 @@ void cortex_m_deinit_target(struct target *target)
 	free(cortex_m);
 }
 
+/* Number of DWT_PCSR reads queued per DAP run while profiling */
+#define CORTEX_M_PCSR_BATCH	1024
+
+/* DWT_PCSR reads as all ones while the core is halted or sleeping */
+#define CORTEX_M_PCSR_INVALID	0xFFFFFFFF
+
 int cortex_m_profiling(struct target *target, uint32_t *samples,
 			      uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
 {
@@ -1850,7 +2238,7 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 	gettimeofday(&timeout, NULL);
 	timeval_add_time(&timeout, seconds, 0);
 
-	LOG_INFO("Starting Cortex-M profiling. Sampling DWT_PCSR as fast as we can...");
+	LOG_DEBUG("Starting Cortex-M profiling. Sampling DWT_PCSR as fast as we can...");
 
 	/* Make sure the target is running */
 	target_poll(target);
@@ -1865,17 +2253,26 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 	uint32_t sample_count = 0;
 
 	for (;;) {
+		uint32_t read_count = 1;
+
 		if (armv7m && armv7m->debug_ap) {
-			uint32_t read_count = max_num_samples - sample_count;
-			if (read_count > 1024)
-				read_count = 1024;
+			/* Queue a whole batch of non-incrementing reads of the
+			 * same register, so one adapter round trip returns many
+			 * samples. Samples land in the output buffer and are
+			 * compacted in place below. */
+			read_count = max_num_samples - sample_count;
+			if (read_count > CORTEX_M_PCSR_BATCH)
+				read_count = CORTEX_M_PCSR_BATCH;
 
 			retval = mem_ap_read_buf_noincr(armv7m->debug_ap,
-						(void *)&samples[sample_count],
+						(uint8_t *)&samples[sample_count],
 						4, read_count, DWT_PCSR);
-			sample_count += read_count;
+			if (retval == ERROR_OK)
+				for (uint32_t i = 0; i < read_count; i++)
+					samples[sample_count + i] =
+						le_to_h_u32((uint8_t *)&samples[sample_count + i]);
 		} else {
-			target_read_u32(target, DWT_PCSR, &samples[sample_count++]);
+			retval = target_read_u32(target, DWT_PCSR, &samples[sample_count]);
 		}
 
 		if (retval != ERROR_OK) {
@@ -1883,10 +2280,29 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 			return retval;
 		}
 
+		uint32_t valid = 0;
+		for (uint32_t i = 0; i < read_count; i++) {
+			uint32_t pc = samples[sample_count + i];
+			if (pc != CORTEX_M_PCSR_INVALID)
+				samples[sample_count + valid++] = pc;
+		}
+		sample_count += valid;
+
+		/* A batch without a single valid sample means the core stopped
+		 * or sleeps; stop early if it is no longer running at all. */
+		if (valid == 0) {
+			retval = target_poll(target);
+			if (retval != ERROR_OK)
+				return retval;
+			if (target->state != TARGET_RUNNING) {
+				LOG_INFO("Target not running, profiling stopped");
+				break;
+			}
+		}
 
 		gettimeofday(&now, NULL);
 		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
-			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+			LOG_DEBUG("Profiling completed. %" PRIu32 " samples.", sample_count);
 			break;
 		}
 	}
@@ -2078,6 +2494,7 @@ static void cortex_m_dwt_free(struct target *target)
 				free(cache->reg_list[i].arch_info);
 			free(cache->reg_list);
 		}
+		register_cache_index_free(cache);
 		free(cache);
 	}
 	cm->dwt_cache = NULL;
@@ -2103,44 +2520,88 @@ static int cortex_m_find_mem_ap(struct adiv5_dap *swjdp,
 	return dap_find_ap(swjdp, AP_TYPE_AHB5_AP, debug_ap);
 }
 
+static int cortex_m_examine_ap(struct target *target)
+{
+	int retval;
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct adiv5_dap *swjdp = cortex_m->armv7m.arm.dap;
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (cortex_m->apsel == DP_APSEL_INVALID) {
+		/* Search for the MEM-AP */
+		retval = cortex_m_find_mem_ap(swjdp, &armv7m->debug_ap);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Could not find MEM-AP to control the core");
+			return retval;
+		}
+	} else {
+		armv7m->debug_ap = dap_ap(swjdp, cortex_m->apsel);
+	}
+
+	/* Leave (only) generic DAP stuff for debugport_init(); */
+	armv7m->debug_ap->memaccess_tck = 8;
+
+	return mem_ap_init(armv7m->debug_ap);
+}
+
+static int cortex_m_examine_queue(struct target *target)
+{
+	int retval;
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	cortex_m->examine_is_queued = false;
+	if (target_was_examined(target))
+		return ERROR_OK;
+
+	retval = cortex_m_examine_ap(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = mem_ap_read_u32(armv7m->debug_ap, CPUID, &cortex_m->examine_cpuid);
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &cortex_m->examine_dhcsr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	cortex_m->examine_is_queued = true;
+	cortex_m->examine_queued_at = armv7m->debug_ap->dap->run_count;
+	return ERROR_OK;
+}
+
 int cortex_m_examine(struct target *target)
 {
 	int retval;
 	uint32_t cpuid, fpcr, mvfr0, mvfr1;
 	int i;
 	struct cortex_m_common *cortex_m = target_to_cm(target);
-	struct adiv5_dap *swjdp = cortex_m->armv7m.arm.dap;
 	struct armv7m_common *armv7m = target_to_armv7m(target);
+	bool queued = cortex_m->examine_is_queued;
 
 	/* stlink shares the examine handler but does not support
 	 * all its calls */
-	if (!armv7m->stlink) {
-		if (cortex_m->apsel == DP_APSEL_INVALID) {
-			/* Search for the MEM-AP */
-			retval = cortex_m_find_mem_ap(swjdp, &armv7m->debug_ap);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Could not find MEM-AP to control the core");
-				return retval;
-			}
-		} else {
-			armv7m->debug_ap = dap_ap(swjdp, cortex_m->apsel);
-		}
-
-		/* Leave (only) generic DAP stuff for debugport_init(); */
-		armv7m->debug_ap->memaccess_tck = 8;
-
-		retval = mem_ap_init(armv7m->debug_ap);
+	cortex_m->examine_is_queued = false;
+	if (!armv7m->stlink && !queued) {
+		retval = cortex_m_examine_ap(target);
 		if (retval != ERROR_OK)
 			return retval;
 	}
 
+	/* complete the reads cortex_m_examine_queue() left in the queue */
+	if (queued && dap_run_queued(armv7m->debug_ap->dap, cortex_m->examine_queued_at) != ERROR_OK)
+		queued = false;
+
 	if (!target_was_examined(target)) {
 		target_set_examined(target);
 
 		/* Read from Device Identification Registers */
-		retval = target_read_u32(target, CPUID, &cpuid);
-		if (retval != ERROR_OK)
-			return retval;
+		if (queued) {
+			cpuid = cortex_m->examine_cpuid;
+		} else {
+			retval = target_read_u32(target, CPUID, &cpuid);
+			if (retval != ERROR_OK)
+				return retval;
+		}
 
 		/* Get CPU Type */
 		i = (cpuid >> 4) & 0xf;
@@ -2236,9 +2697,13 @@ int cortex_m_examine(struct target *target)
 		}
 
 		/* Enable debug requests */
-		retval = target_read_u32(target, DCB_DHCSR, &cortex_m->dcb_dhcsr);
-		if (retval != ERROR_OK)
-			return retval;
+		if (queued) {
+			cortex_m->dcb_dhcsr = cortex_m->examine_dhcsr;
+		} else {
+			retval = target_read_u32(target, DCB_DHCSR, &cortex_m->dcb_dhcsr);
+			if (retval != ERROR_OK)
+				return retval;
+		}
 		if (!(cortex_m->dcb_dhcsr & C_DEBUGEN)) {
 			uint32_t dhcsr = (cortex_m->dcb_dhcsr | C_DEBUGEN) & ~(C_HALT | C_STEP | C_MASKINTS);
 
@@ -2404,6 +2869,7 @@ static int cortex_m_init_arch_info(struct target *target,
 	armv7m->pre_restore_context = NULL;
 
 	armv7m->load_core_reg_u32 = cortex_m_load_core_reg_u32;
+	armv7m->load_core_regs = cortex_m_load_core_regs;
 	armv7m->store_core_reg_u32 = cortex_m_store_core_reg_u32;
 
 	target_register_timer_callback(cortex_m_handle_target_request, 1,
@@ -2671,6 +3137,7 @@ struct target_type cortexm_target = {
 	.deprecated_name = "cortex_m3",
 
 	.poll = cortex_m_poll,
+	.poll_queue = cortex_m_poll_queue,
 	.arch_state = armv7m_arch_state,
 
 	.target_request_data = cortex_m_target_request_data,
@@ -2690,6 +3157,7 @@ struct target_type cortexm_target = {
 	.write_memory = cortex_m_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.fill_memory = armv7m_fill_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
@@ -2705,6 +3173,7 @@ struct target_type cortexm_target = {
 	.target_jim_configure = adiv5_jim_configure,
 	.init_target = cortex_m_init_target,
 	.examine = cortex_m_examine,
+	.examine_queue = cortex_m_examine_queue,
 	.deinit_target = cortex_m_deinit_target,
 
 	.profiling = cortex_m_profiling,
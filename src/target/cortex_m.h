@@ -190,6 +190,17 @@ struct cortex_m_common {
 
 	/* Context information */
 	uint32_t dcb_dhcsr;
+	/* DHCSR read queued by cortex_m_poll_queue(), consumed by the next poll */
+	uint32_t dcb_dhcsr_queued;
+	bool dcb_dhcsr_is_queued;
+	unsigned int dcb_dhcsr_queued_at;
+	/* sticky DHCSR bits read by a queued read that was not used */
+	uint32_t dcb_dhcsr_sticky;
+	/* CPUID and DHCSR reads queued by cortex_m_examine_queue() */
+	uint32_t examine_cpuid;
+	uint32_t examine_dhcsr;
+	bool examine_is_queued;
+	unsigned int examine_queued_at;
 	uint32_t nvic_dfsr;  /* Debug Fault Status Register - shows reason for debug halt */
 	uint32_t nvic_icsr;  /* Interrupt Control State Register - shows active and pending IRQ */
 
@@ -235,7 +246,7 @@ int cortex_m_add_breakpoint(struct target *target, struct breakpoint *breakpoint
 int cortex_m_remove_breakpoint(struct target *target, struct breakpoint *breakpoint);
 int cortex_m_add_watchpoint(struct target *target, struct watchpoint *watchpoint);
 int cortex_m_remove_watchpoint(struct target *target, struct watchpoint *watchpoint);
-void cortex_m_enable_breakpoints(struct target *target);
+int cortex_m_enable_breakpoints(struct target *target);
 void cortex_m_enable_watchpoints(struct target *target);
 void cortex_m_deinit_target(struct target *target);
 int cortex_m_profiling(struct target *target, uint32_t *samples,
@@ -174,7 +174,7 @@ struct reg_cache *embeddedice_build_reg_cache(struct target *target,
 		struct arm7_9_common *arm7_9)
 {
 	int retval;
-	struct reg_cache *reg_cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *reg_cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = NULL;
 	struct embeddedice_reg *arch_info = NULL;
 	struct arm_jtag *jtag_info = &arm7_9->jtag_info;
@@ -316,6 +316,7 @@ void embeddedice_free_reg_cache(struct reg_cache *reg_cache)
 
 	free(reg_cache->reg_list[0].arch_info);
 	free(reg_cache->reg_list);
+	register_cache_index_free(reg_cache);
 	free(reg_cache);
 }
 
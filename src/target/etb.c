@@ -123,7 +123,7 @@ static const struct reg_arch_type etb_reg_type = {
 
 struct reg_cache *etb_build_reg_cache(struct etb *etb)
 {
-	struct reg_cache *reg_cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *reg_cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = NULL;
 	struct etb_reg *arch_info = NULL;
 	int num_regs = 9;
@@ -622,7 +622,11 @@ static int adapter_resume(struct target *target, int current,
 
 	if (!debug_execution) {
 		target_free_all_working_areas(target);
-		cortex_m_enable_breakpoints(target);
+		res = cortex_m_enable_breakpoints(target);
+		if (res != ERROR_OK) {
+			LOG_ERROR("not resuming, breakpoints could not be set");
+			return res;
+		}
 		cortex_m_enable_watchpoints(target);
 	}
 
@@ -825,6 +829,7 @@ struct target_type hla_target = {
 	.write_memory = adapter_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.fill_memory = armv7m_fill_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
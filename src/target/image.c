@@ -838,6 +838,35 @@ int image_open(struct image *image, const char *url, const char *type_string)
 	return retval;
 };
 
+int image_section_file_range(struct image *image, int section, uint32_t offset,
+		uint32_t *size, struct fileio **fileio, size_t *file_offset)
+{
+	if (offset > image->sections[section].size)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (image->type == IMAGE_BINARY) {
+		struct image_binary *image_binary = image->type_private;
+
+		*size = MIN(*size, image->sections[section].size - offset);
+		*fileio = image_binary->fileio;
+		*file_offset = offset;
+		return ERROR_OK;
+	} else if (image->type == IMAGE_ELF) {
+		struct image_elf *elf = image->type_private;
+		Elf32_Phdr *segment = (Elf32_Phdr *)image->sections[section].private;
+		uint32_t filesz = field32(elf, segment->p_filesz);
+
+		/* only the initialized part of a segment is in the file */
+		*size = (offset < filesz) ? MIN(*size, filesz - offset) : 0;
+		*fileio = elf->fileio;
+		*file_offset = field32(elf, segment->p_offset) + offset;
+		return ERROR_OK;
+	}
+
+	/* decoded into memory by image_open(), or read from a target */
+	return ERROR_IMAGE_TYPE_UNKNOWN;
+}
+
 int image_read_section(struct image *image,
 	int section,
 	uint32_t offset,
@@ -1019,36 +1048,231 @@ void image_close(struct image *image)
 	image->sections = NULL;
 }
 
+/* The checksum is the CRC32 used by gdb: polynomial 0x04c11db7, processed
+ * most significant bit first, initial value 0xffffffff and no final xor. */
+#define IMAGE_CRC32_POLY 0x04c11db7
+
+/* crc32_tables[0] is the classic byte-at-a-time table, crc32_tables[k]
+ * advances a byte by k more zero bytes, for slicing-by-8 */
+static uint32_t crc32_tables[8][256];
+
+static void image_crc32_init_tables(void)
+{
+	static bool tables_ready;
+	if (tables_ready)
+		return;
+
+	for (unsigned int i = 0; i < 256; i++) {
+		uint32_t c = i << 24;
+		for (unsigned int j = 0; j < 8; j++)
+			c = c & 0x80000000 ? (c << 1) ^ IMAGE_CRC32_POLY : (c << 1);
+		crc32_tables[0][i] = c;
+	}
+	for (unsigned int k = 1; k < 8; k++) {
+		for (unsigned int i = 0; i < 256; i++) {
+			uint32_t c = crc32_tables[k - 1][i];
+			crc32_tables[k][i] = (c << 8) ^ crc32_tables[0][c >> 24];
+		}
+	}
+
+	tables_ready = true;
+}
+
+static bool image_crc32_always_supported(void)
+{
+	return true;
+}
+
+static uint32_t image_crc32_bytewise(uint32_t crc, const uint8_t *buffer, size_t nbytes)
+{
+	while (nbytes--) {
+		/* as per gdb */
+		crc = (crc << 8) ^ crc32_tables[0][((crc >> 24) ^ *buffer++) & 255];
+	}
+	return crc;
+}
+
+static uint32_t image_crc32_slice8(uint32_t crc, const uint8_t *buffer, size_t nbytes)
+{
+	const uint32_t (*t)[256] = crc32_tables;
+
+	while (nbytes >= 8) {
+		uint32_t one = crc ^ be_to_h_u32(buffer);
+		crc = t[7][one >> 24] ^ t[6][(one >> 16) & 255] ^
+			t[5][(one >> 8) & 255] ^ t[4][one & 255] ^
+			t[3][buffer[4]] ^ t[2][buffer[5]] ^
+			t[1][buffer[6]] ^ t[0][buffer[7]];
+		buffer += 8;
+		nbytes -= 8;
+	}
+
+	return image_crc32_bytewise(crc, buffer, nbytes);
+}
+
+/* x^n mod P, used as folding constants by the carry-less multiply variants */
+static uint32_t image_crc32_xpow_mod(unsigned int n)
+{
+	uint32_t r = 1;
+	while (n--)
+		r = r & 0x80000000 ? (r << 1) ^ IMAGE_CRC32_POLY : (r << 1);
+	return r;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+static bool image_crc32_pclmul_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+/* Folds 128 bit blocks with PCLMULQDQ: for a block X = Xh * x^64 + Xl
+ * followed by n bits, X * x^n is congruent to Xh * (x^(n+64) mod P) +
+ * Xl * (x^n mod P), which fits in the next block. The remainder left in
+ * the last block is finished with the tables. */
+__attribute__((target("pclmul,ssse3")))
+static uint32_t image_crc32_pclmul(uint32_t crc, const uint8_t *buffer, size_t nbytes)
+{
+	static __m128i k128, k512;
+	static bool constants_ready;
+
+	if (nbytes < 64)
+		return image_crc32_slice8(crc, buffer, nbytes);
+
+	if (!constants_ready) {
+		k128 = _mm_set_epi64x(image_crc32_xpow_mod(192), image_crc32_xpow_mod(128));
+		k512 = _mm_set_epi64x(image_crc32_xpow_mod(576), image_crc32_xpow_mod(512));
+		constants_ready = true;
+	}
+
+	/* byte reverse, so bit 127 holds the first bit of the message */
+	const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+#define CRC32_LOAD(p) _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p)), swap)
+#define CRC32_FOLD(x, k, y) _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), \
+		_mm_clmulepi64_si128(x, k, 0x00)), y)
+
+	/* the initial value is xor-ed into the first 32 bits of the message */
+	__m128i x0 = _mm_xor_si128(CRC32_LOAD(buffer), _mm_set_epi32(crc, 0, 0, 0));
+	__m128i x1 = CRC32_LOAD(buffer + 16);
+	__m128i x2 = CRC32_LOAD(buffer + 32);
+	__m128i x3 = CRC32_LOAD(buffer + 48);
+	buffer += 64;
+	nbytes -= 64;
+
+	while (nbytes >= 64) {
+		x0 = CRC32_FOLD(x0, k512, CRC32_LOAD(buffer));
+		x1 = CRC32_FOLD(x1, k512, CRC32_LOAD(buffer + 16));
+		x2 = CRC32_FOLD(x2, k512, CRC32_LOAD(buffer + 32));
+		x3 = CRC32_FOLD(x3, k512, CRC32_LOAD(buffer + 48));
+		buffer += 64;
+		nbytes -= 64;
+	}
+
+	x0 = CRC32_FOLD(x0, k128, x1);
+	x0 = CRC32_FOLD(x0, k128, x2);
+	x0 = CRC32_FOLD(x0, k128, x3);
+
+	while (nbytes >= 16) {
+		x0 = CRC32_FOLD(x0, k128, CRC32_LOAD(buffer));
+		buffer += 16;
+		nbytes -= 16;
+	}
+
+	uint8_t rest[16];
+	_mm_storeu_si128((__m128i *)rest, _mm_shuffle_epi8(x0, swap));
+#undef CRC32_FOLD
+#undef CRC32_LOAD
+
+	crc = image_crc32_slice8(0, rest, sizeof(rest));
+	return image_crc32_slice8(crc, buffer, nbytes);
+}
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_acle.h>
+
+static bool image_crc32_armv8_supported(void)
+{
+	return getauxval(AT_HWCAP) & HWCAP_CRC32;
+}
+
+static inline uint64_t image_crc32_rbit64(uint64_t v)
+{
+	__asm__("rbit %0, %1" : "=r" (v) : "r" (v));
+	return v;
+}
+
+/* The ARMv8 CRC32 instructions use the same polynomial, but bit reflected.
+ * Reflecting every byte of the message, the initial value and the result
+ * gives the most significant bit first CRC. */
+__attribute__((target("+crc")))
+static uint32_t image_crc32_armv8(uint32_t crc, const uint8_t *buffer, size_t nbytes)
+{
+	crc = image_crc32_rbit64(crc) >> 32;
+
+	while (nbytes >= 8) {
+		uint64_t data;
+		memcpy(&data, buffer, sizeof(data));
+		/* reverse the bits in each byte, keeping the byte order */
+		crc = __crc32d(crc, __builtin_bswap64(image_crc32_rbit64(data)));
+		buffer += 8;
+		nbytes -= 8;
+	}
+
+	while (nbytes--)
+		crc = __crc32b(crc, image_crc32_rbit64(*buffer++) >> 56);
+
+	return image_crc32_rbit64(crc) >> 32;
+}
+#endif
+
+const struct image_checksum_impl image_checksum_impls[] = {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	{ "pclmul", image_crc32_pclmul_supported, image_crc32_pclmul },
+#endif
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+	{ "armv8-crc", image_crc32_armv8_supported, image_crc32_armv8 },
+#endif
+	{ "slice8", image_crc32_always_supported, image_crc32_slice8 },
+	{ "bytewise", image_crc32_always_supported, image_crc32_bytewise },
+	{ NULL, NULL, NULL }
+};
+
+/* Pick the first supported implementation, fastest ones come first */
+const struct image_checksum_impl *image_checksum_get_impl(void)
+{
+	static const struct image_checksum_impl *impl;
+
+	image_crc32_init_tables();
+
+	if (impl == NULL) {
+		for (impl = image_checksum_impls; impl->name; impl++) {
+			if (impl->supported())
+				break;
+		}
+		LOG_DEBUG("using %s CRC32 implementation", impl->name);
+	}
+
+	return impl;
+}
+
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
 {
 	uint32_t crc = 0xffffffff;
 	LOG_DEBUG("Calculating checksum");
 
-	static uint32_t crc32_table[256];
-
-	static bool first_init;
-	if (!first_init) {
-		/* Initialize the CRC table and the decoding table.  */
-		unsigned int i, j, c;
-		for (i = 0; i < 256; i++) {
-			/* as per gdb */
-			for (c = i << 24, j = 8; j > 0; --j)
-				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
-		}
-
-		first_init = true;
-	}
+	const struct image_checksum_impl *impl = image_checksum_get_impl();
 
 	while (nbytes > 0) {
-		int run = nbytes;
-		if (run > 32768)
-			run = 32768;
+		uint32_t run = nbytes;
+		if (run > 1024 * 1024)
+			run = 1024 * 1024;
 		nbytes -= run;
-		while (run--) {
-			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
-		}
+		crc = impl->update(crc, buffer, run);
+		buffer += run;
 		keep_alive();
 	}
 
@@ -94,6 +94,14 @@ struct image_mot {
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, uint32_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+/**
+ * Find where section data is stored as is in the image file, so that it can
+ * be read with fileio_read_at(). On success, *size is reduced to the number
+ * of bytes from @a offset on that are stored in the file, possibly 0.
+ * Fails for image types that don't read the section data from a file.
+ */
+int image_section_file_range(struct image *image, int section, uint32_t offset,
+		uint32_t *size, struct fileio **fileio, size_t *file_offset);
 void image_close(struct image *image);
 
 int image_add_section(struct image *image, uint32_t base, uint32_t size,
@@ -102,6 +110,17 @@ int image_add_section(struct image *image, uint32_t base, uint32_t size,
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
 
+/* Host implementations of the image checksum, selected at runtime */
+struct image_checksum_impl {
+	const char *name;
+	bool (*supported)(void);
+	uint32_t (*update)(uint32_t crc, const uint8_t *buffer, size_t nbytes);
+};
+
+/* All implementations built in, fastest first, terminated by a NULL name */
+extern const struct image_checksum_impl image_checksum_impls[];
+const struct image_checksum_impl *image_checksum_get_impl(void);
+
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
 #define ERROR_IMAGE_TEMPORARILY_UNAVAILABLE		(-1402)
@@ -59,18 +59,98 @@ struct reg *register_get_by_number(struct reg_cache *first,
 	return NULL;
 }
 
+/*
+ * Name lookups go through an open addressing hash of each cache, so
+ * targets with thousands of registers (e.g. RISC-V CSRs) don't strcmp()
+ * every one of them.  Slots hold reg_list indexes + 1 and are filled in
+ * reg_list order, so probing finds duplicated names in that order too.
+ */
+struct reg_cache_index {
+	const struct reg *reg_list;	/* what the index was built for */
+	unsigned num_regs;
+	uint32_t mask;			/* number of slots - 1 */
+	uint32_t slots[];
+};
+
+/* bumped whenever registers may have moved, see register_handle_get() */
+static unsigned int register_generation;
+
+static uint32_t register_name_hash(const char *name)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	while (*name)
+		h = (h ^ (uint8_t)*name++) * 16777619u;
+	return h;
+}
+
+static struct reg_cache_index *register_cache_get_index(struct reg_cache *cache)
+{
+	struct reg_cache_index *index = cache->index;
+
+	if (index && index->reg_list == cache->reg_list && index->num_regs == cache->num_regs)
+		return index;
+
+	register_cache_index_free(cache);
+
+	uint32_t size = 16;
+	while (size < 2 * cache->num_regs)
+		size <<= 1;
+
+	index = calloc(1, sizeof(*index) + size * sizeof(index->slots[0]));
+	if (index == NULL)
+		return NULL;
+
+	index->reg_list = cache->reg_list;
+	index->num_regs = cache->num_regs;
+	index->mask = size - 1;
+
+	for (unsigned i = 0; i < cache->num_regs; i++) {
+		if (cache->reg_list[i].name == NULL)
+			continue;
+		uint32_t h = register_name_hash(cache->reg_list[i].name) & index->mask;
+		while (index->slots[h])
+			h = (h + 1) & index->mask;
+		index->slots[h] = i + 1;
+	}
+
+	cache->index = index;
+	return index;
+}
+
+void register_cache_index_free(struct reg_cache *cache)
+{
+	if (cache->index == NULL)
+		return;
+
+	free(cache->index);
+	cache->index = NULL;
+	register_generation++;
+}
+
 struct reg *register_get_by_name(struct reg_cache *first,
 		const char *name, bool search_all)
 {
 	unsigned i;
 	struct reg_cache *cache = first;
+	uint32_t hash = register_name_hash(name);
 
 	while (cache) {
-		for (i = 0; i < cache->num_regs; i++) {
-			if (cache->reg_list[i].exist == false)
-				continue;
-			if (strcmp(cache->reg_list[i].name, name) == 0)
-				return &(cache->reg_list[i]);
+		struct reg_cache_index *index = register_cache_get_index(cache);
+
+		if (index) {
+			for (uint32_t h = hash & index->mask; index->slots[h]; h = (h + 1) & index->mask) {
+				struct reg *reg = &cache->reg_list[index->slots[h] - 1];
+				if (reg->exist && strcmp(reg->name, name) == 0)
+					return reg;
+			}
+		} else {
+			for (i = 0; i < cache->num_regs; i++) {
+				if (cache->reg_list[i].exist == false)
+					continue;
+				if (strcmp(cache->reg_list[i].name, name) == 0)
+					return &(cache->reg_list[i]);
+			}
 		}
 
 		if (search_all)
@@ -82,6 +162,21 @@ struct reg *register_get_by_name(struct reg_cache *first,
 	return NULL;
 }
 
+struct reg *register_handle_get(struct reg_cache *first,
+		struct reg_handle *handle, bool search_all)
+{
+	if (handle->reg && handle->first == first
+			&& handle->generation == register_generation && handle->reg->exist)
+		return handle->reg;
+
+	handle->reg = register_get_by_name(first, handle->name, search_all);
+	handle->first = first;
+	/* the lookup may have (re)built indexes */
+	handle->generation = register_generation;
+
+	return handle->reg;
+}
+
 struct reg_cache **register_get_last_cache_p(struct reg_cache **first)
 {
 	struct reg_cache **cache_p = first;
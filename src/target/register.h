@@ -147,13 +147,37 @@ struct reg {
 	const struct reg_arch_type *type;
 };
 
+struct reg_cache_index;
+
 struct reg_cache {
 	const char *name;
 	struct reg_cache *next;
 	struct reg *reg_list;
 	unsigned num_regs;
+	/* Name hash of reg_list, built by the first register_get_by_name()
+	 * and rebuilt when reg_list or num_regs change. Must start as NULL;
+	 * release it with register_cache_index_free(). */
+	struct reg_cache_index *index;
 };
 
+/**
+ * A register looked up by name once and then reused, e.g. in a loop:
+ *
+ *	static struct reg_handle pc_handle = REG_HANDLE_INIT("pc");
+ *	struct reg *pc = register_handle_get(target->reg_cache, &pc_handle, true);
+ *
+ * The lookup is repeated only when a different cache is passed, or when
+ * any register cache was rebuilt or freed since.
+ */
+struct reg_handle {
+	const char *name;
+	struct reg_cache *first;
+	struct reg *reg;
+	unsigned int generation;
+};
+
+#define REG_HANDLE_INIT(reg_name) { .name = (reg_name) }
+
 struct reg_arch_type {
 	int (*get)(struct reg *reg);
 	int (*set)(struct reg *reg, uint8_t *buf);
@@ -163,9 +187,12 @@ struct reg *register_get_by_number(struct reg_cache *first,
 		uint32_t reg_num, bool search_all);
 struct reg *register_get_by_name(struct reg_cache *first,
 		const char *name, bool search_all);
+struct reg *register_handle_get(struct reg_cache *first,
+		struct reg_handle *handle, bool search_all);
 struct reg_cache **register_get_last_cache_p(struct reg_cache **first);
 void register_unlink_cache(struct reg_cache **cache_p, const struct reg_cache *cache);
 void register_cache_invalidate(struct reg_cache *cache);
+void register_cache_index_free(struct reg_cache *cache);
 
 void register_init_dummy(struct reg *reg);
 
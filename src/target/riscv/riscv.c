@@ -463,6 +463,7 @@ static void riscv_free_registers(struct target *target)
 				free(target->reg_cache->reg_list[i].arch_info);
 			free(target->reg_cache->reg_list);
 		}
+		register_cache_index_free(target->reg_cache);
 		free(target->reg_cache);
 	}
 }
@@ -1856,6 +1857,56 @@ static int riscv_checksum_memory(struct target *target,
 	return ERROR_FAIL;
 }
 
+static int riscv_fill_memory(struct target *target, target_addr_t address,
+		uint32_t size, const uint8_t *pattern)
+{
+	struct working_area *fill_algorithm;
+	struct reg_param reg_params[4];
+	unsigned xlen = riscv_xlen(target);
+	int retval;
+
+	static const uint8_t riscv_fill_code[] = {
+#include "../../../contrib/loaders/fill/riscv_fill.inc"
+	};
+
+	if (target_alloc_working_area(target, sizeof(riscv_fill_code),
+				&fill_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = target_write_buffer(target, fill_algorithm->address,
+			sizeof(riscv_fill_code), riscv_fill_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	init_reg_param(&reg_params[0], "a0", xlen, PARAM_OUT);
+	init_reg_param(&reg_params[1], "a1", xlen, PARAM_OUT);
+	init_reg_param(&reg_params[2], "a2", xlen, PARAM_OUT);
+	init_reg_param(&reg_params[3], "a3", xlen, PARAM_OUT);
+
+	buf_set_u64(reg_params[0].value, 0, xlen, address);
+	buf_set_u64(reg_params[1].value, 0, xlen, size);
+	buf_set_u64(reg_params[2].value, 0, xlen, target_buffer_get_u32(target, pattern));
+	buf_set_u64(reg_params[3].value, 0, xlen, target_buffer_get_u32(target, pattern + 4));
+
+	/* assume at least 1 MB/s */
+	int timeout = 2000 + size / 1000;
+
+	retval = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params), reg_params,
+			fill_algorithm->address,
+			fill_algorithm->address + sizeof(riscv_fill_code) - 4,
+			timeout, NULL);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing RISC-V fill algorithm");
+
+	for (unsigned i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+cleanup:
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
 /*** OpenOCD Helper Functions ***/
 
 enum riscv_poll_hart {
@@ -2762,6 +2813,7 @@ struct target_type riscv_target = {
 	.write_phys_memory = riscv_write_phys_memory,
 
 	.checksum_memory = riscv_checksum_memory,
+	.fill_memory = riscv_fill_memory,
 
 	.mmu = riscv_mmu,
 	.virt2phys = riscv_virt2phys,
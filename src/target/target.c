@@ -56,6 +56,10 @@
 #include "transport/transport.h"
 #include "arm_cti.h"
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
 
@@ -68,6 +72,14 @@ static int target_array2mem(Jim_Interp *interp, struct target *target,
 static int target_mem2array(Jim_Interp *interp, struct target *target,
 		int argc, Jim_Obj * const *argv);
 static int target_register_user_commands(struct command_context *cmd_ctx);
+static int handle_target(void *priv);
+static void target_timer_callback_expedite(int (*callback)(void *priv),
+		unsigned int delay_ms);
+static int target_backup_working_areas_before_write(struct target *target,
+		target_addr_t address, uint32_t size);
+static int target_backup_working_areas_before_algorithm(struct target *target);
+static int target_free_working_area_restore(struct target *target,
+		struct working_area *area, int restore);
 static int target_get_gdb_fileio_info_default(struct target *target,
 		struct gdb_fileio_info *fileio_info);
 static int target_gdb_fileio_end_default(struct target *target, int retcode,
@@ -155,10 +167,20 @@ static struct target_type *target_types[] = {
 
 struct target *all_targets;
 static struct target_event_callback *target_event_callbacks;
-static struct target_timer_callback *target_timer_callbacks;
+/* Timer callbacks, kept in a binary min-heap ordered by deadline */
+static struct target_timer_callback **target_timer_heap;
+static unsigned int target_timer_count;
+static unsigned int target_timer_alloc;
+static bool target_timer_processing;
+/* set while target_call_timer_callbacks_now() ignores deadlines */
+static bool target_timer_forced;
 static LIST_HEAD(target_reset_callback_list);
 static LIST_HEAD(target_trace_callback_list);
 static const int polling_interval = 100;
+/* shortest poll interval, used right after a target was resumed or halted */
+#define TARGET_POLL_INTERVAL_MIN	10
+/* longest poll interval, reached by targets that stay halted */
+#define TARGET_POLL_INTERVAL_MAX	1000
 
 static const Jim_Nvp nvp_assert[] = {
 	{ .name = "assert", NVP_ASSERT },
@@ -573,6 +595,24 @@ int target_poll(struct target *target)
 	return ERROR_OK;
 }
 
+/* Poll the target, and the rest of its SMP group, again shortly; its
+ * state is about to change. */
+static void target_poll_soon(struct target *target)
+{
+	int64_t next = monotonic_ms() + TARGET_POLL_INTERVAL_MIN;
+
+	if (target->smp) {
+		for (struct target_list *head = target->head; head; head = head->next) {
+			head->target->poll_interval_ms = TARGET_POLL_INTERVAL_MIN;
+			head->target->poll_next_ms = next;
+		}
+	}
+	target->poll_interval_ms = TARGET_POLL_INTERVAL_MIN;
+	target->poll_next_ms = next;
+
+	target_timer_callback_expedite(&handle_target, TARGET_POLL_INTERVAL_MIN);
+}
+
 int target_halt(struct target *target)
 {
 	int retval;
@@ -588,6 +628,7 @@ int target_halt(struct target *target)
 
 	target->halt_issued = true;
 	target->halt_issued_time = timeval_ms();
+	target_poll_soon(target);
 
 	return ERROR_OK;
 }
@@ -643,6 +684,7 @@ int target_resume(struct target *target, int current, target_addr_t address,
 	if (retval != ERROR_OK)
 		return retval;
 
+	target_poll_soon(target);
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_END);
 
 	return retval;
@@ -720,10 +762,20 @@ static int default_check_reset(struct target *target)
 
 /* Equivalent Tcl code arp_examine_one is in src/target/startup.tcl
  * Keep in sync */
-int target_examine_one(struct target *target)
+static void target_examine_queue_one(struct target *target)
 {
 	target_call_event_callbacks(target, TARGET_EVENT_EXAMINE_START);
 
+	if (target->type->examine_queue) {
+		int retval = target->type->examine_queue(target);
+		if (retval != ERROR_OK)
+			LOG_DEBUG("target %s: queued examine failed, examining synchronously",
+					target_name(target));
+	}
+}
+
+static int target_examine_complete_one(struct target *target)
+{
 	int retval = target->type->examine(target);
 	if (retval != ERROR_OK) {
 		target_call_event_callbacks(target, TARGET_EVENT_EXAMINE_FAIL);
@@ -735,6 +787,13 @@ int target_examine_one(struct target *target)
 	return ERROR_OK;
 }
 
+int target_examine_one(struct target *target)
+{
+	target_examine_queue_one(target);
+
+	return target_examine_complete_one(target);
+}
+
 static int jtag_enable_callback(enum jtag_event event, void *priv)
 {
 	struct target *target = priv;
@@ -757,6 +816,26 @@ int target_examine(void)
 	int retval = ERROR_OK;
 	struct target *target;
 
+	/*
+	 * Queue the first examine transactions of all targets before
+	 * completing any of them, so that targets on different DAPs or
+	 * adapters share flushes instead of taking turns. An examine-start
+	 * handler may prepare the hardware for the targets that follow it,
+	 * so with any of them each target is examined in turn as before.
+	 */
+	bool batch = true;
+	for (target = all_targets; target; target = target->next) {
+		if (target_has_event_action(target, TARGET_EVENT_EXAMINE_START))
+			batch = false;
+	}
+
+	for (target = all_targets; batch && target; target = target->next) {
+		if (!target->tap->enabled || target->defer_examine)
+			continue;
+
+		target_examine_queue_one(target);
+	}
+
 	for (target = all_targets; target; target = target->next) {
 		/* defer examination, but don't skip it */
 		if (!target->tap->enabled) {
@@ -768,7 +847,10 @@ int target_examine(void)
 		if (target->defer_examine)
 			continue;
 
-		int retval2 = target_examine_one(target);
+		if (!batch)
+			target_examine_queue_one(target);
+
+		int retval2 = target_examine_complete_one(target);
 		if (retval2 != ERROR_OK) {
 			LOG_WARNING("target %s examination failed", target_name(target));
 			retval = retval2;
@@ -825,6 +907,10 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	retval = target_backup_working_areas_before_algorithm(target);
+	if (retval != ERROR_OK)
+		goto done;
+
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
@@ -864,6 +950,10 @@ int target_start_algorithm(struct target *target,
 		goto done;
 	}
 
+	retval = target_backup_working_areas_before_algorithm(target);
+	if (retval != ERROR_OK)
+		goto done;
+
 	target->running_alg = true;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
@@ -959,7 +1049,7 @@ int target_run_flash_async_algorithm(struct target *target,
 		uint32_t entry_point, uint32_t exit_point, void *arch_info)
 {
 	int retval;
-	int timeout = 0;
+	struct async_algorithm_stats *stats = &target->async_stats;
 
 	const uint8_t *buffer_orig = buffer;
 
@@ -970,12 +1060,28 @@ int target_run_flash_async_algorithm(struct target *target,
 	uint32_t fifo_start_addr = buffer_start + 8;
 	uint32_t fifo_end_addr = buffer_start + buffer_size;
 
+	uint32_t fifo_size = fifo_end_addr - fifo_start_addr;
+
 	uint32_t wp = fifo_start_addr;
 	uint32_t rp = fifo_start_addr;
 
 	/* validate block_size is 2^n */
 	assert(!block_size || !(block_size & (block_size - 1)));
 
+	/* Minimum amount of free space worth a refill, starting at a quarter
+	 * of the fifo. It shrinks when the target drains the fifo and grows
+	 * while the host fills it much faster than the target drains it. */
+	uint32_t chunk = (fifo_size / 4) & ~(block_size - 1);
+	if (chunk < (uint32_t)block_size)
+		chunk = block_size;
+	unsigned int poll_interval = 2;
+	uint32_t written = 0;
+	uint32_t last_rp = rp;
+
+	memset(stats, 0, sizeof(*stats));
+	int64_t start_ms = timeval_ms();
+	int64_t progress_ms = start_ms;
+
 	retval = target_write_u32(target, wp_addr, wp);
 	if (retval != ERROR_OK)
 		return retval;
@@ -1028,16 +1134,50 @@ int target_run_flash_async_algorithm(struct target *target,
 		else
 			thisrun_bytes = fifo_end_addr - wp - block_size;
 
-		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * programming. The exact delay shouldn't matter as long as it's
-			 * less than buffer size / flash speed. This is very unlikely to
-			 * run when using high latency connections such as USB. */
-			alive_sleep(2);
+		stats->polls++;
+		int64_t now = timeval_ms();
 
-			/* to stop an infinite loop on some targets check and increment a timeout
+		/* reset our timeout whenever the target made any progress */
+		if (rp != last_rp) {
+			progress_ms = now;
+			last_rp = rp;
+		}
+		uint32_t fill = (wp >= rp) ? wp - rp : fifo_size - (rp - wp);
+		/* drain rate of the target in bytes per ms, 0 if not known yet */
+		uint32_t rate = (now > start_ms) ? (written - fill) / (now - start_ms) : 0;
+
+		if (written && fill == 0) {
+			/* the target caught up with us, feed it sooner */
+			stats->starved++;
+			if (chunk > (uint32_t)block_size)
+				chunk = (chunk / 2) & ~(block_size - 1);
+			if (poll_interval > 1)
+				poll_interval /= 2;
+		}
+
+		/* Wait for more room unless the space found runs up to the wrap
+		 * around, is all that is left to write or the fifo is empty. */
+		if (thisrun_bytes == 0 || (fill && thisrun_bytes < chunk
+				&& thisrun_bytes < count * block_size
+				&& wp + thisrun_bytes < fifo_end_addr)) {
+			stats->stalls++;
+
+			/* Throttle polling if transfer is faster than flash programming,
+			 * sleeping about as long as the target needs to make room for a
+			 * chunk. That is always less than it takes to drain the fifo. */
+			if (rate)
+				poll_interval = (chunk - thisrun_bytes) / rate;
+			else
+				poll_interval *= 2;
+			if (poll_interval < 1)
+				poll_interval = 1;
+			if (poll_interval > 50)
+				poll_interval = 50;
+			alive_sleep(poll_interval);
+
+			/* to stop an infinite loop on some targets check for a timeout
 			 * this issue was observed on a stellaris using the new ICDI interface */
-			if (timeout++ >= 2500) {
+			if (timeval_ms() - progress_ms > 5000) {
 				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
 				return ERROR_FLASH_OPERATION_FAILED;
 			}
@@ -1045,7 +1185,7 @@ int target_run_flash_async_algorithm(struct target *target,
 		}
 
 		/* reset our timeout */
-		timeout = 0;
+		progress_ms = now;
 
 		/* Limit to the amount of data we actually want to write */
 		if (thisrun_bytes > count * block_size)
@@ -1060,6 +1200,15 @@ int target_run_flash_async_algorithm(struct target *target,
 		if (retval != ERROR_OK)
 			break;
 
+		stats->refills++;
+		written += thisrun_bytes;
+
+		/* Filling is much faster than draining: bigger chunks save
+		 * transfer overhead, the target still has half a fifo to go. */
+		if (rate && (timeval_ms() - now) * 2 * rate < thisrun_bytes
+				&& chunk <= fifo_size / 4)
+			chunk *= 2;
+
 		/* Update counters and wrap write pointer */
 		buffer += thisrun_bytes;
 		count -= thisrun_bytes / block_size;
@@ -1101,6 +1250,15 @@ int target_run_flash_async_algorithm(struct target *target,
 		}
 	}
 
+	stats->bytes = written;
+	stats->elapsed_ms = timeval_ms() - start_ms;
+	stats->chunk_size = chunk;
+	stats->poll_interval = poll_interval;
+	LOG_DEBUG("async algorithm: %" PRIu32 " bytes in %" PRId64 " ms, %u polls, "
+			"%u stalls, %u starved, %u refills, chunk %" PRIu32 ", poll %u ms",
+			stats->bytes, stats->elapsed_ms, stats->polls, stats->stalls,
+			stats->starved, stats->refills, stats->chunk_size, stats->poll_interval);
+
 	return retval;
 }
 
@@ -1293,6 +1451,9 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	int retval = target_backup_working_areas_before_write(target, address, size * count);
+	if (retval != ERROR_OK)
+		return retval;
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1493,8 +1654,6 @@ static void target_reset_examined(struct target *target)
 	target->examined = false;
 }
 
-static int handle_target(void *priv);
-
 static int target_init_one(struct command_context *cmd_ctx,
 		struct target *target)
 {
@@ -1574,7 +1733,7 @@ static int target_init(struct command_context *cmd_ctx)
 		return retval;
 
 	retval = target_register_timer_callback(&handle_target,
-			polling_interval, TARGET_TIMER_TYPE_PERIODIC, cmd_ctx->interp);
+			TARGET_POLL_INTERVAL_MIN, TARGET_TIMER_TYPE_PERIODIC, cmd_ctx->interp);
 	if (ERROR_OK != retval)
 		return retval;
 
@@ -1677,35 +1836,124 @@ int target_register_trace_callback(int (*callback)(struct target *target,
 	return ERROR_OK;
 }
 
+static void target_timer_heap_place(unsigned int i, struct target_timer_callback *cb)
+{
+	target_timer_heap[i] = cb;
+	cb->heap_index = i;
+}
+
+static void target_timer_heap_sift_up(struct target_timer_callback *cb)
+{
+	unsigned int i = cb->heap_index;
+
+	while (i > 0) {
+		unsigned int parent = (i - 1) / 2;
+		if (target_timer_heap[parent]->when <= cb->when)
+			break;
+		target_timer_heap_place(i, target_timer_heap[parent]);
+		i = parent;
+	}
+	target_timer_heap_place(i, cb);
+}
+
+static void target_timer_heap_sift_down(struct target_timer_callback *cb)
+{
+	unsigned int i = cb->heap_index;
+
+	for (;;) {
+		unsigned int child = 2 * i + 1;
+		if (child >= target_timer_count)
+			break;
+		if (child + 1 < target_timer_count &&
+				target_timer_heap[child + 1]->when < target_timer_heap[child]->when)
+			child++;
+		if (cb->when <= target_timer_heap[child]->when)
+			break;
+		target_timer_heap_place(i, target_timer_heap[child]);
+		i = child;
+	}
+	target_timer_heap_place(i, cb);
+}
+
+/* Take a callback out of the heap; the caller frees it. */
+static void target_timer_heap_remove(struct target_timer_callback *cb)
+{
+	struct target_timer_callback *last = target_timer_heap[--target_timer_count];
+
+	if (last == cb)
+		return;
+	target_timer_heap_place(cb->heap_index, last);
+	target_timer_heap_sift_up(last);
+	target_timer_heap_sift_down(last);
+}
+
 int target_register_timer_callback(int (*callback)(void *priv),
 		unsigned int time_ms, enum target_timer_type type, void *priv)
 {
-	struct target_timer_callback **callbacks_p = &target_timer_callbacks;
-
 	if (callback == NULL)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	if (*callbacks_p) {
-		while ((*callbacks_p)->next)
-			callbacks_p = &((*callbacks_p)->next);
-		callbacks_p = &((*callbacks_p)->next);
+	if (target_timer_count == target_timer_alloc) {
+		unsigned int alloc = target_timer_alloc ? 2 * target_timer_alloc : 16;
+		struct target_timer_callback **heap = realloc(target_timer_heap,
+				alloc * sizeof(*heap));
+		if (heap == NULL) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		target_timer_heap = heap;
+		target_timer_alloc = alloc;
 	}
 
-	(*callbacks_p) = malloc(sizeof(struct target_timer_callback));
-	(*callbacks_p)->callback = callback;
-	(*callbacks_p)->type = type;
-	(*callbacks_p)->time_ms = time_ms;
-	(*callbacks_p)->removed = false;
+	struct target_timer_callback *cb = malloc(sizeof(*cb));
+	if (cb == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 
-	gettimeofday(&(*callbacks_p)->when, NULL);
-	timeval_add_time(&(*callbacks_p)->when, 0, time_ms * 1000);
+	cb->callback = callback;
+	cb->type = type;
+	cb->time_ms = time_ms;
+	cb->removed = false;
+	cb->when = monotonic_ms() + time_ms;
+	cb->priv = priv;
+	cb->run = 0;
 
-	(*callbacks_p)->priv = priv;
-	(*callbacks_p)->next = NULL;
+	target_timer_heap_place(target_timer_count++, cb);
+	target_timer_heap_sift_up(cb);
 
 	return ERROR_OK;
 }
 
+/* Change the period of a registered periodic callback; when called by
+ * the callback itself, this already applies to its next invocation. */
+static void target_timer_callback_set_period(int (*callback)(void *priv),
+		unsigned int time_ms)
+{
+	for (unsigned int i = 0; i < target_timer_count; i++) {
+		struct target_timer_callback *cb = target_timer_heap[i];
+		if (cb->callback == callback && !cb->removed)
+			cb->time_ms = time_ms;
+	}
+}
+
+/* Invoke a registered periodic callback within delay_ms, unless it is
+ * due earlier anyway. */
+static void target_timer_callback_expedite(int (*callback)(void *priv),
+		unsigned int delay_ms)
+{
+	int64_t when = monotonic_ms() + delay_ms;
+
+	for (unsigned int i = 0; i < target_timer_count; i++) {
+		struct target_timer_callback *cb = target_timer_heap[i];
+		if (cb->callback != callback || cb->removed || cb->when <= when)
+			continue;
+		cb->when = when;
+		target_timer_heap_sift_up(cb);
+		return;
+	}
+}
+
 int target_unregister_event_callback(int (*callback)(struct target *target,
 		enum target_event event, void *priv), void *priv)
 {
@@ -1772,10 +2020,17 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 	if (callback == NULL)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	for (struct target_timer_callback *c = target_timer_callbacks;
-	     c; c = c->next) {
-		if ((c->callback == callback) && (c->priv == priv)) {
-			c->removed = true;
+	for (unsigned int i = 0; i < target_timer_count; i++) {
+		struct target_timer_callback *c = target_timer_heap[i];
+		if (!c->removed && (c->callback == callback) && (c->priv == priv)) {
+			/* While callbacks run the heap must stay put; the entry
+			 * is dropped once it reaches the top. */
+			if (target_timer_processing) {
+				c->removed = true;
+			} else {
+				target_timer_heap_remove(c);
+				free(c);
+			}
 			return ERROR_OK;
 		}
 	}
@@ -1831,66 +2086,76 @@ int target_call_trace_callbacks(struct target *target, size_t len, uint8_t *data
 	return ERROR_OK;
 }
 
-static int target_timer_callback_periodic_restart(
-		struct target_timer_callback *cb, struct timeval *now)
-{
-	cb->when = *now;
-	timeval_add_time(&cb->when, 0, cb->time_ms * 1000L);
-	return ERROR_OK;
-}
-
-static int target_call_timer_callback(struct target_timer_callback *cb,
-		struct timeval *now)
-{
-	cb->callback(cb->priv);
-
-	if (cb->type == TARGET_TIMER_TYPE_PERIODIC)
-		return target_timer_callback_periodic_restart(cb, now);
-
-	return target_unregister_timer_callback(cb->callback, cb->priv);
-}
-
 static int target_call_timer_callbacks_check_time(int checktime)
 {
-	static bool callback_processing;
+	static unsigned int run;
 
 	/* Do not allow nesting */
-	if (callback_processing)
+	if (target_timer_processing)
 		return ERROR_OK;
 
-	callback_processing = true;
+	target_timer_processing = true;
 
 	keep_alive();
 
-	struct timeval now;
-	gettimeofday(&now, NULL);
-
-	/* Store an address of the place containing a pointer to the
-	 * next item; initially, that's a standalone "root of the
-	 * list" variable. */
-	struct target_timer_callback **callback = &target_timer_callbacks;
-	while (callback && *callback) {
-		if ((*callback)->removed) {
-			struct target_timer_callback *p = *callback;
-			*callback = (*callback)->next;
-			free(p);
-			continue;
+	int64_t now = monotonic_ms();
+	run++;
+
+	if (!checktime) {
+		target_timer_forced = true;
+		/* Invoke every periodic callback regardless of its deadline.
+		 * Registrations from within a callback only move entries to
+		 * higher indexes, and the run stamp keeps those from being
+		 * called twice; heap order is restored afterwards. */
+		for (unsigned int i = 0; i < target_timer_count; i++) {
+			struct target_timer_callback *cb = target_timer_heap[i];
+			if (cb->removed || cb->run == run || cb->type != TARGET_TIMER_TYPE_PERIODIC)
+				continue;
+			cb->run = run;
+			cb->callback(cb->priv);
+			cb->when = now + cb->time_ms;
 		}
+		for (unsigned int i = target_timer_count / 2; i-- > 0; )
+			target_timer_heap_sift_down(target_timer_heap[i]);
+		target_timer_forced = false;
+	}
 
-		bool call_it = (*callback)->callback &&
-			((!checktime && (*callback)->type == TARGET_TIMER_TYPE_PERIODIC) ||
-			 timeval_compare(&now, &(*callback)->when) >= 0);
+	/* Pop due callbacks in deadline order, each at most once per run */
+	while (target_timer_count > 0) {
+		struct target_timer_callback *cb = target_timer_heap[0];
+
+		if (cb->removed) {
+			target_timer_heap_remove(cb);
+			free(cb);
+			continue;
+		}
+		if (cb->when > now || cb->run == run)
+			break;
 
-		if (call_it)
-			target_call_timer_callback(*callback, &now);
+		cb->run = run;
+		cb->callback(cb->priv);
 
-		callback = &(*callback)->next;
+		if (cb->removed || cb->type != TARGET_TIMER_TYPE_PERIODIC) {
+			target_timer_heap_remove(cb);
+			free(cb);
+		} else {
+			cb->when = now + cb->time_ms;
+			target_timer_heap_sift_up(cb);
+			target_timer_heap_sift_down(cb);
+		}
 	}
 
-	callback_processing = false;
+	target_timer_processing = false;
 	return ERROR_OK;
 }
 
+int64_t target_timer_next_event(void)
+{
+	if (target_timer_count == 0)
+		return INT64_MAX;
+	return target_timer_heap[0]->when;
+}
+
 int target_call_timer_callbacks(void)
 {
 	return target_call_timer_callbacks_check_time(1);
@@ -1908,13 +2173,150 @@ static void print_wa_layout(struct target *target)
 	struct working_area *c = target->working_areas;
 
 	while (c) {
-		LOG_DEBUG("%c%c " TARGET_ADDR_FMT "-" TARGET_ADDR_FMT " (%" PRIu32 " bytes)",
-			c->backup ? 'b' : ' ', c->free ? ' ' : '*',
-			c->address, c->address + c->size - 1, c->size);
+		LOG_DEBUG("%c%c " TARGET_ADDR_FMT "-" TARGET_ADDR_FMT " (%" PRIu32 " bytes)%s%s",
+			c->num_saved ? 'b' : ' ', c->free ? ' ' : '*',
+			c->address, c->address + c->size - 1, c->size,
+			c->resident ? " resident " : "", c->resident ? c->resident : "");
 		c = c->next;
 	}
 }
 
+static void target_free_working_area_backup(struct working_area *area)
+{
+	free(area->backup);
+	area->backup = NULL;
+	free(area->saved);
+	area->saved = NULL;
+	area->num_saved = 0;
+}
+
+/* Save the original content of [offset, offset + size) of an allocated area,
+ * reading back only the parts that are not already held in its backup. */
+static int target_backup_working_area_range(struct target *target,
+		struct working_area *area, uint32_t offset, uint32_t size)
+{
+	/* Areas are word aligned, so keep the backup in whole words */
+	uint32_t start = offset & ~3UL;
+	uint32_t end = (offset + size + 3) & ~3UL;
+	if (end > area->size)
+		end = area->size;
+	if (start >= end)
+		return ERROR_OK;
+
+	if (area->backup == NULL) {
+		area->backup = malloc(area->size);
+		if (area->backup == NULL)
+			return ERROR_FAIL;
+	}
+
+	/* Read the gaps between the ranges saved so far */
+	struct working_area_range *r = area->saved;
+	uint32_t pos = start;
+	for (unsigned int i = 0; i < area->num_saved && pos < end; i++) {
+		if (r[i].offset + r[i].size <= pos)
+			continue;
+		if (r[i].offset >= end)
+			break;
+		if (r[i].offset > pos) {
+			int retval = target_read_memory(target, area->address + pos, 4,
+					(r[i].offset - pos) / 4, area->backup + pos);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		pos = r[i].offset + r[i].size;
+	}
+	if (pos < end) {
+		int retval = target_read_memory(target, area->address + pos, 4,
+				(end - pos) / 4, area->backup + pos);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	/* Replace the saved ranges overlapping or touching [start, end) by their union */
+	unsigned int lo = 0;
+	while (lo < area->num_saved && r[lo].offset + r[lo].size < start)
+		lo++;
+	unsigned int hi = lo;
+	while (hi < area->num_saved && r[hi].offset <= end)
+		hi++;
+
+	if (lo < hi) {
+		if (r[lo].offset < start)
+			start = r[lo].offset;
+		if (r[hi - 1].offset + r[hi - 1].size > end)
+			end = r[hi - 1].offset + r[hi - 1].size;
+	} else {
+		r = realloc(area->saved, (area->num_saved + 1) * sizeof(*r));
+		if (r == NULL)
+			return ERROR_FAIL;
+		area->saved = r;
+		hi = lo + 1;
+		memmove(r + hi, r + lo, (area->num_saved - lo) * sizeof(*r));
+		area->num_saved++;
+	}
+
+	memmove(r + lo + 1, r + hi, (area->num_saved - hi) * sizeof(*r));
+	area->num_saved -= hi - lo - 1;
+	r[lo].offset = start;
+	r[lo].size = end - start;
+
+	return ERROR_OK;
+}
+
+/* With lazy backup, save what a host write to [address, address + size)
+ * is about to overwrite in any allocated working area. */
+static int target_backup_working_areas_before_write(struct target *target,
+		target_addr_t address, uint32_t size)
+{
+	/* A resident algorithm that gets overwritten has to be uploaded again */
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->resident_data && address < c->address + c->size && address + size > c->address) {
+			LOG_DEBUG("resident algorithm %s overwritten", c->resident);
+			free(c->resident_data);
+			c->resident_data = NULL;
+		}
+	}
+
+	if (target->backup_working_area != WORK_AREA_BACKUP_DIRTY)
+		return ERROR_OK;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free || address >= c->address + c->size || address + size <= c->address)
+			continue;
+
+		target_addr_t start = MAX(address, c->address);
+		target_addr_t end = MIN(address + size, c->address + c->size);
+		int retval = target_backup_working_area_range(target, c,
+				start - c->address, end - start);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("failed to back up working area at address " TARGET_ADDR_FMT,
+					c->address);
+			return retval;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* An algorithm may use allocated areas the host never wrote to (stack, scratch
+ * or output buffers), so save those completely before it starts running. */
+static int target_backup_working_areas_before_algorithm(struct target *target)
+{
+	if (target->backup_working_area != WORK_AREA_BACKUP_DIRTY)
+		return ERROR_OK;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free || c->num_saved)
+			continue;
+
+		int retval = target_backup_working_area_range(target, c, 0, c->size);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 /* Reduce area to size bytes, create a new free area from the remaining bytes, if any. */
 static void target_split_working_area(struct working_area *area, uint32_t size)
 {
@@ -1932,6 +2334,12 @@ static void target_split_working_area(struct working_area *area, uint32_t size)
 		new_wa->size = area->size - size;
 		new_wa->address = area->address + size;
 		new_wa->backup = NULL;
+		new_wa->saved = NULL;
+		new_wa->num_saved = 0;
+		new_wa->resident = NULL;
+		new_wa->resident_data = NULL;
+		new_wa->refcount = 0;
+		new_wa->last_use = 0;
 		new_wa->user = NULL;
 		new_wa->free = true;
 
@@ -1940,8 +2348,7 @@ static void target_split_working_area(struct working_area *area, uint32_t size)
 
 		/* If backup memory was allocated to this area, it has the wrong size
 		 * now so free it and it will be reallocated if/when needed */
-		free(area->backup);
-		area->backup = NULL;
+		target_free_working_area_backup(area);
 	}
 }
 
@@ -1961,19 +2368,63 @@ static void target_merge_working_areas(struct target *target)
 			/* Remove the last */
 			struct working_area *to_be_freed = c->next;
 			c->next = c->next->next;
-			free(to_be_freed->backup);
+			target_free_working_area_backup(to_be_freed);
 			free(to_be_freed);
 
 			/* If backup memory was allocated to the remaining area, it's has
 			 * the wrong size now */
-			free(c->backup);
-			c->backup = NULL;
+			target_free_working_area_backup(c);
 		} else {
 			c = c->next;
 		}
 	}
 }
 
+static struct working_area *target_find_best_fit_working_area(struct target *target, uint32_t size)
+{
+	struct working_area *best = NULL;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free && c->size >= size && (best == NULL || c->size < best->size))
+			best = c;
+	}
+
+	return best;
+}
+
+static void target_clear_resident_working_area(struct working_area *area)
+{
+	free(area->resident);
+	area->resident = NULL;
+	free(area->resident_data);
+	area->resident_data = NULL;
+	area->refcount = 0;
+}
+
+/* Free the least recently used resident algorithm nobody holds a reference to.
+ * Returns false if there is none. */
+static bool target_evict_resident_working_area(struct target *target)
+{
+	struct working_area *lru = NULL;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->resident && c->refcount == 0 && (lru == NULL || c->last_use < lru->last_use))
+			lru = c;
+	}
+
+	if (lru == NULL)
+		return false;
+
+	LOG_DEBUG("evicting resident algorithm %s", lru->resident);
+	target_clear_resident_working_area(lru);
+
+	/* Free it even if its backup can't be restored, so that allocation makes progress */
+	if (target_free_working_area_restore(target, lru, 1) != ERROR_OK)
+		target_free_working_area_restore(target, lru, 0);
+
+	return true;
+}
+
 int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
 {
 	/* Reevaluate working area address based on MMU state*/
@@ -2016,6 +2467,12 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 			new_wa->size = target->working_area_size & ~3UL; /* 4-byte align */
 			new_wa->address = target->working_area;
 			new_wa->backup = NULL;
+			new_wa->saved = NULL;
+			new_wa->num_saved = 0;
+			new_wa->resident = NULL;
+			new_wa->resident_data = NULL;
+			new_wa->refcount = 0;
+			new_wa->last_use = 0;
 			new_wa->user = NULL;
 			new_wa->free = true;
 		}
@@ -2027,32 +2484,23 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	if (size % 4)
 		size = (size + 3) & (~3UL);
 
-	struct working_area *c = target->working_areas;
-
-	/* Find the first large enough working area */
-	while (c) {
-		if (c->free && c->size >= size)
-			break;
-		c = c->next;
+	/* Find the smallest large enough working area, making room by evicting
+	 * resident algorithms nobody uses if there is none */
+	struct working_area *c;
+	while ((c = target_find_best_fit_working_area(target, size)) == NULL) {
+		if (!target_evict_resident_working_area(target))
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
 
-	if (c == NULL)
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-
 	/* Split the working area into the requested size */
 	target_split_working_area(c, size);
 
 	LOG_DEBUG("allocated new working area of %" PRIu32 " bytes at address " TARGET_ADDR_FMT,
 			  size, c->address);
 
-	if (target->backup_working_area) {
-		if (c->backup == NULL) {
-			c->backup = malloc(c->size);
-			if (c->backup == NULL)
-				return ERROR_FAIL;
-		}
-
-		int retval = target_read_memory(target, c->address, 4, c->size / 4, c->backup);
+	/* With lazy backup, the content is saved when first written to instead */
+	if (target->backup_working_area == WORK_AREA_BACKUP_FULL) {
+		int retval = target_backup_working_area_range(target, c, 0, c->size);
 		if (retval != ERROR_OK)
 			return retval;
 	}
@@ -2080,20 +2528,84 @@ int target_alloc_working_area(struct target *target, uint32_t size, struct worki
 
 }
 
-static int target_restore_working_area(struct target *target, struct working_area *area)
+/* Saved ranges waiting to be written back, joined while they are contiguous */
+struct working_area_restore {
+	target_addr_t address;
+	uint32_t size;
+	const uint8_t *data;	/* points into a backup until a second range is joined */
+	uint8_t *buffer;
+	uint32_t buffer_size;
+};
+
+static int target_flush_working_area_restore(struct target *target,
+		struct working_area_restore *wr)
 {
 	int retval = ERROR_OK;
 
-	if (target->backup_working_area && area->backup != NULL) {
-		retval = target_write_memory(target, area->address, 4, area->size / 4, area->backup);
+	if (wr->size) {
+		retval = target_write_memory(target, wr->address, 4, wr->size / 4, wr->data);
 		if (retval != ERROR_OK)
 			LOG_ERROR("failed to restore %" PRIu32 " bytes of working area at address " TARGET_ADDR_FMT,
-					area->size, area->address);
+					wr->size, wr->address);
+	}
+	wr->size = 0;
+
+	return retval;
+}
+
+static int target_queue_working_area_restore(struct target *target,
+		struct working_area_restore *wr, struct working_area *area)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < area->num_saved; i++) {
+		target_addr_t address = area->address + area->saved[i].offset;
+		uint32_t size = area->saved[i].size;
+		const uint8_t *data = area->backup + area->saved[i].offset;
+
+		if (wr->size && wr->address + wr->size == address) {
+			if (wr->size + size > wr->buffer_size) {
+				uint8_t *buffer = malloc(wr->size + size);
+				if (buffer) {
+					memcpy(buffer, wr->data, wr->size);
+					free(wr->buffer);
+					wr->buffer = buffer;
+					wr->buffer_size = wr->size + size;
+					wr->data = buffer;
+				}
+			} else if (wr->data != wr->buffer) {
+				memcpy(wr->buffer, wr->data, wr->size);
+				wr->data = wr->buffer;
+			}
+			if (wr->data == wr->buffer && wr->size + size <= wr->buffer_size) {
+				memcpy(wr->buffer + wr->size, data, size);
+				wr->size += size;
+				continue;
+			}
+		}
+
+		int retval2 = target_flush_working_area_restore(target, wr);
+		if (retval2 != ERROR_OK)
+			retval = retval2;
+		wr->address = address;
+		wr->size = size;
+		wr->data = data;
 	}
 
 	return retval;
 }
 
+static int target_restore_working_area(struct target *target, struct working_area *area)
+{
+	struct working_area_restore wr = { .size = 0, .buffer = NULL, .buffer_size = 0 };
+
+	int retval = target_queue_working_area_restore(target, &wr, area);
+	int retval2 = target_flush_working_area_restore(target, &wr);
+	free(wr.buffer);
+
+	return retval != ERROR_OK ? retval : retval2;
+}
+
 /* Restore the area's backup memory, if any, and return the area to the allocation pool */
 static int target_free_working_area_restore(struct target *target, struct working_area *area, int restore)
 {
@@ -2110,6 +2622,7 @@ static int target_free_working_area_restore(struct target *target, struct workin
 	}
 
 	area->free = true;
+	area->num_saved = 0;
 
 	LOG_DEBUG("freed %" PRIu32 " bytes of working area at address " TARGET_ADDR_FMT,
 			area->size, area->address);
@@ -2118,7 +2631,8 @@ static int target_free_working_area_restore(struct target *target, struct workin
 	/* TODO: Is this really safe? It points to some previous caller's memory.
 	 * How could we know that the area pointer is still in that place and not
 	 * some other vital data? What's the purpose of this, anyway? */
-	*area->user = NULL;
+	if (area->user)
+		*area->user = NULL;
 	area->user = NULL;
 
 	target_merge_working_areas(target);
@@ -2128,32 +2642,116 @@ static int target_free_working_area_restore(struct target *target, struct workin
 	return retval;
 }
 
-int target_free_working_area(struct target *target, struct working_area *area)
+int target_alloc_resident_working_area(struct target *target, const char *name,
+		const uint8_t *data, uint32_t size, struct working_area **area)
 {
-	return target_free_working_area_restore(target, area, 1);
-}
+	static unsigned int use_count;
+	struct working_area *c;
 
-/* free resources and restore memory, if restoring memory fails,
- * free up resources anyway
- */
-static void target_free_all_working_areas_restore(struct target *target, int restore)
-{
-	struct working_area *c = target->working_areas;
+	for (c = target->working_areas; c; c = c->next) {
+		if (c->resident && !strcmp(c->resident, name))
+			break;
+	}
 
-	LOG_DEBUG("freeing all working areas");
+	if (c && (c->resident_data == NULL || c->size != ((size + 3) & ~3UL)
+			|| memcmp(c->resident_data, data, size))) {
+		/* Stale or different code under the same name */
+		if (c->refcount == 0) {
+			target_clear_resident_working_area(c);
+			target_free_working_area_restore(target, c, 1);
+		} else {
+			free(c->resident);
+			c->resident = NULL;
+		}
+		c = NULL;
+	}
+
+	if (c) {
+		LOG_DEBUG("reusing resident algorithm %s at address " TARGET_ADDR_FMT,
+				name, c->address);
+	} else {
+		int retval = target_alloc_working_area(target, size, &c);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = target_write_buffer(target, c->address, size, data);
+		if (retval != ERROR_OK) {
+			target_free_working_area(target, c);
+			return retval;
+		}
+
+		c->resident = strdup(name);
+		c->resident_data = malloc(size);
+		if (c->resident == NULL || c->resident_data == NULL) {
+			target_clear_resident_working_area(c);
+			target_free_working_area(target, c);
+			return ERROR_FAIL;
+		}
+		memcpy(c->resident_data, data, size);
+
+		/* The area outlives the caller's pointer */
+		c->user = NULL;
+	}
+
+	c->refcount++;
+	c->last_use = ++use_count;
+	*area = c;
+
+	return ERROR_OK;
+}
+
+int target_free_working_area(struct target *target, struct working_area *area)
+{
+	/* Keep resident algorithms in place for the next user */
+	if (area->resident) {
+		if (area->refcount)
+			area->refcount--;
+		return ERROR_OK;
+	}
+
+	/* Orphaned by a newer copy of its algorithm, release it with the last user */
+	if (area->refcount > 1) {
+		area->refcount--;
+		return ERROR_OK;
+	}
+	target_clear_resident_working_area(area);
+
+	return target_free_working_area_restore(target, area, 1);
+}
 
-	/* Loop through all areas, restoring the allocated ones and marking them as free */
+/* free resources and restore memory, if restoring memory fails,
+ * free up resources anyway
+ */
+static void target_free_all_working_areas_restore(struct target *target, int restore)
+{
+	struct working_area *c = target->working_areas;
+	struct working_area_restore wr = { .size = 0, .buffer = NULL, .buffer_size = 0 };
+
+	LOG_DEBUG("freeing all working areas");
+
+	/* Loop through all areas, restoring the allocated ones and marking them as free.
+	 * The list is sorted by address, so saved ranges of neighbouring areas are
+	 * written back together. */
 	while (c) {
 		if (!c->free) {
 			if (restore)
-				target_restore_working_area(target, c);
+				target_queue_working_area_restore(target, &wr, c);
+			target_clear_resident_working_area(c);
 			c->free = true;
-			*c->user = NULL; /* Same as above */
+			if (c->user)
+				*c->user = NULL; /* Same as above */
 			c->user = NULL;
 		}
 		c = c->next;
 	}
 
+	if (restore)
+		target_flush_working_area_restore(target, &wr);
+	free(wr.buffer);
+
+	for (c = target->working_areas; c; c = c->next)
+		c->num_saved = 0;
+
 	/* Run a merge pass to combine all areas into one */
 	target_merge_working_areas(target);
 
@@ -2167,7 +2765,7 @@ void target_free_all_working_areas(struct target *target)
 	/* Now we have none or only one working area marked as free */
 	if (target->working_areas) {
 		/* Free the last one to allow on-the-fly moving and resizing */
-		free(target->working_areas->backup);
+		target_free_working_area_backup(target->working_areas);
 		free(target->working_areas);
 		target->working_areas = NULL;
 	}
@@ -2182,9 +2780,16 @@ uint32_t target_get_working_area_avail(struct target *target)
 	if (c == NULL)
 		return target->working_area_size;
 
+	/* Unused resident algorithms get evicted on demand, so count them as free */
+	uint32_t run = 0;
 	while (c) {
-		if (c->free && max_size < c->size)
-			max_size = c->size;
+		if (c->free || (c->resident && c->refcount == 0)) {
+			run += c->size;
+			if (max_size < run)
+				max_size = run;
+		} else {
+			run = 0;
+		}
 
 		c = c->next;
 	}
@@ -2192,6 +2797,27 @@ uint32_t target_get_working_area_avail(struct target *target)
 	return max_size;
 }
 
+/* per-block checksums of a memory range, see mem_snapshot command */
+struct mem_snapshot {
+	target_addr_t address;
+	uint32_t size;
+	uint32_t block_size;
+	uint32_t *crc;		/* one checksum per block, last block may be short */
+	struct mem_snapshot *next;
+};
+
+static void mem_snapshot_free_all(struct target *target)
+{
+	struct mem_snapshot *snapshot = target->mem_snapshots;
+	while (snapshot) {
+		struct mem_snapshot *next = snapshot->next;
+		free(snapshot->crc);
+		free(snapshot);
+		snapshot = next;
+	}
+	target->mem_snapshots = NULL;
+}
+
 static void target_destroy(struct target *target)
 {
 	if (target->type->deinit_target)
@@ -2210,6 +2836,8 @@ static void target_destroy(struct target *target)
 	}
 
 	target_free_all_working_areas(target);
+	mem_snapshot_free_all(target);
+	bpwp_index_free(target);
 
 	/* release the targets SMP list */
 	if (target->smp) {
@@ -2243,13 +2871,12 @@ void target_quit(void)
 	}
 	target_event_callbacks = NULL;
 
-	struct target_timer_callback *pt = target_timer_callbacks;
-	while (pt) {
-		struct target_timer_callback *t = pt->next;
-		free(pt);
-		pt = t;
-	}
-	target_timer_callbacks = NULL;
+	for (unsigned int i = 0; i < target_timer_count; i++)
+		free(target_timer_heap[i]);
+	free(target_timer_heap);
+	target_timer_heap = NULL;
+	target_timer_count = 0;
+	target_timer_alloc = 0;
 
 	for (struct target *target = all_targets; target;) {
 		struct target *tmp;
@@ -2301,17 +2928,23 @@ int target_profiling_default(struct target *target, uint32_t *samples,
 	gettimeofday(&timeout, NULL);
 	timeval_add_time(&timeout, seconds, 0);
 
-	LOG_INFO("Starting profiling. Halting and resuming the"
+	LOG_DEBUG("Starting profiling. Halting and resuming the"
 			" target as often as we can...");
 
 	uint32_t sample_count = 0;
-	/* hopefully it is safe to cache! We want to stop/restart as quickly as possible. */
-	struct reg *reg = register_get_by_name(target->reg_cache, "pc", 1);
+	/* We want to stop/restart as quickly as possible, so look pc up only once. */
+	struct reg_handle pc_handle = REG_HANDLE_INIT("pc");
 
 	int retval = ERROR_OK;
 	for (;;) {
 		target_poll(target);
 		if (target->state == TARGET_HALTED) {
+			struct reg *reg = register_handle_get(target->reg_cache, &pc_handle, true);
+			if (reg == NULL) {
+				LOG_ERROR("Target has no pc register");
+				retval = ERROR_FAIL;
+				break;
+			}
 			uint32_t t = buf_get_u32(reg->value, 0, 32);
 			samples[sample_count++] = t;
 			/* current pc, addr = 0, do not handle breakpoints, not debugging */
@@ -2332,7 +2965,7 @@ int target_profiling_default(struct target *target, uint32_t *samples,
 
 		gettimeofday(&now, NULL);
 		if ((sample_count >= max_num_samples) || timeval_compare(&now, &timeout) >= 0) {
-			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+			LOG_DEBUG("Profiling completed. %" PRIu32 " samples.", sample_count);
 			break;
 		}
 	}
@@ -2366,6 +2999,10 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	int retval = target_backup_working_areas_before_write(target, address, size);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2475,7 +3112,10 @@ int target_checksum_memory(struct target *target, target_addr_t address, uint32_
 		return ERROR_FAIL;
 	}
 
-	retval = target->type->checksum_memory(target, address, size, &checksum);
+	if (target->type->checksum_memory)
+		retval = target->type->checksum_memory(target, address, size, &checksum);
+	else
+		retval = ERROR_FAIL;
 	if (retval != ERROR_OK) {
 		buffer = malloc(size);
 		if (buffer == NULL) {
@@ -2957,61 +3597,136 @@ static int handle_target(void *priv)
 		recursive = 0;
 	}
 
+	/* Each target has its own poll interval: short right after it was
+	 * resumed or halted, doubling up to polling_interval while it keeps
+	 * running. Targets are only polled when due, unless the callbacks
+	 * are being forced.
+	 */
+	int64_t now = monotonic_ms();
+	bool poll_all = target_timer_forced;
+
 	/* Poll targets for state changes unless that's globally disabled.
-	 * Skip targets that are currently disabled.
+	 * Skip targets that are currently disabled. The status reads of all
+	 * due targets are queued first, so that cores sharing a DAP are
+	 * served by a single flush in the poll loop below.
 	 */
 	for (struct target *target = all_targets;
 			is_jtag_poll_safe() && target;
 			target = target->next) {
 
+		target->poll_due = false;
+
 		if (!target_was_examined(target))
 			continue;
 
 		if (!target->tap->enabled)
 			continue;
 
+		if (!poll_all && target->poll_next_ms > now)
+			continue;
+
 		if (target->backoff.times > target->backoff.count) {
 			/* do not poll this time as we failed previously */
 			target->backoff.count++;
+			target->poll_next_ms = now + polling_interval;
 			continue;
 		}
 		target->backoff.count = 0;
 
 		/* only poll target if we've got power and srst isn't asserted */
-		if (!powerDropout && !srstAsserted) {
-			/* polling may fail silently until the target has been examined */
-			retval = target_poll(target);
-			if (retval != ERROR_OK) {
-				/* 100ms polling interval. Increase interval between polling up to 5000ms */
-				if (target->backoff.times * polling_interval < 5000) {
-					target->backoff.times *= 2;
-					target->backoff.times++;
-				}
+		if (powerDropout || srstAsserted)
+			continue;
 
-				/* Tell GDB to halt the debugger. This allows the user to
-				 * run monitor commands to handle the situation.
-				 */
-				target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
-			}
-			if (target->backoff.times > 0) {
-				LOG_USER("Polling target %s failed, trying to reexamine", target_name(target));
-				target_reset_examined(target);
-				retval = target_examine_one(target);
-				/* Target examination could have failed due to unstable connection,
-				 * but we set the examined flag anyway to repoll it later */
-				if (retval != ERROR_OK) {
-					target->examined = true;
-					LOG_USER("Examination failed, GDB will be halted. Polling again in %dms",
-						 target->backoff.times * polling_interval);
-					return retval;
-				}
+		target->poll_due = true;
+		if (target->type->poll_queue)
+			target->type->poll_queue(target);
+	}
+
+	/* poll_due stays set while the target is polled, telling it that a
+	 * queued status read belongs to this run; it is cleared for every
+	 * target, also when polling was disabled meanwhile. */
+	int examine_retval = ERROR_OK;
+	for (struct target *target = all_targets; target; target = target->next) {
+
+		if (!target->poll_due)
+			continue;
+		if (!is_jtag_poll_safe()) {
+			target->poll_due = false;
+			continue;
+		}
+
+		/* polling may fail silently until the target has been examined */
+		retval = target_poll(target);
+		target->poll_due = false;
+
+		if (retval == ERROR_OK && (target->state == TARGET_RUNNING
+					|| target->state == TARGET_HALTED)) {
+			/* back off while nothing changes: up to polling_interval
+			 * while running, further while halted */
+			unsigned int interval = 2 * target->poll_interval_ms;
+			unsigned int limit = target->state == TARGET_RUNNING
+					? polling_interval : TARGET_POLL_INTERVAL_MAX;
+			if (interval < TARGET_POLL_INTERVAL_MIN)
+				interval = TARGET_POLL_INTERVAL_MIN;
+			if (target->state == TARGET_HALTED && interval < polling_interval)
+				interval = polling_interval;
+			if (interval > limit)
+				interval = limit;
+			target->poll_interval_ms = interval;
+		} else {
+			target->poll_interval_ms = polling_interval;
+		}
+		target->poll_next_ms = now + target->poll_interval_ms;
+
+		if (retval != ERROR_OK) {
+			/* 100ms polling interval. Increase interval between polling up to 5000ms */
+			if (target->backoff.times * polling_interval < 5000) {
+				target->backoff.times *= 2;
+				target->backoff.times++;
 			}
 
-			/* Since we succeeded, we reset backoff count */
-			target->backoff.times = 0;
+			/* Tell GDB to halt the debugger. This allows the user to
+			 * run monitor commands to handle the situation.
+			 */
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
+		}
+		if (target->backoff.times > 0) {
+			LOG_USER("Polling target %s failed, trying to reexamine", target_name(target));
+			target_reset_examined(target);
+			retval = target_examine_one(target);
+			/* Target examination could have failed due to unstable connection,
+			 * but we set the examined flag anyway to repoll it later */
+			if (retval != ERROR_OK) {
+				target->examined = true;
+				LOG_USER("Examination failed, GDB will be halted. Polling again in %dms",
+					 target->backoff.times * polling_interval);
+				examine_retval = retval;
+				continue;
+			}
 		}
+
+		/* Since we succeeded, we reset backoff count */
+		target->backoff.times = 0;
+	}
+
+	/* Sleep until the first target is due. Targets that were not polled
+	 * in this run (not examined, disabled, polling off) are looked at
+	 * again after polling_interval. */
+	int64_t first = INT64_MAX;
+	for (struct target *target = all_targets; target; target = target->next) {
+		int64_t next = target->poll_next_ms;
+		if (next <= now)
+			next = now + polling_interval;
+		if (next < first)
+			first = next;
 	}
+	int64_t delay = first == INT64_MAX ? polling_interval : first - now;
+	if (delay < TARGET_POLL_INTERVAL_MIN)
+		delay = TARGET_POLL_INTERVAL_MIN;
+	target_timer_callback_set_period(&handle_target, delay);
 
+	if (examine_retval != ERROR_OK)
+		return examine_retval;
 	return retval;
 }
 
@@ -3444,9 +4159,99 @@ COMMAND_HANDLER(handle_md_command)
 	return retval;
 }
 
+/* Whether [address, address + size) intersects the working area memory */
+static bool target_overlaps_working_area(struct target *target,
+		target_addr_t address, uint64_t size)
+{
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (address < c->address + c->size && address + size > c->address)
+			return true;
+	}
+
+	/* the areas may not be allocated yet, which address gets used
+	 * depends on the MMU state at that time */
+	if (target->working_area_phys_spec && address < target->working_area_phys
+			+ target->working_area_size && address + size > target->working_area_phys)
+		return true;
+	if (target->working_area_virt_spec && address < target->working_area_virt
+			+ target->working_area_size && address + size > target->working_area_virt)
+		return true;
+
+	return false;
+}
+
 typedef int (*target_write_fn)(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t count, const uint8_t *buffer);
 
+/*
+ * Fill the 8 byte aligned bulk of a region with a target algorithm and
+ * write the unaligned head and tail over the debug link. Returns
+ * ERROR_TARGET_RESOURCE_NOT_AVAILABLE without having written anything
+ * if the target can't run the algorithm.
+ */
+static int target_fill_mem_algorithm(struct target *target,
+		target_addr_t address, unsigned data_size, uint64_t b, unsigned c)
+{
+	uint8_t pattern[8];
+	uint64_t size = (uint64_t)c * data_size;
+
+	if (!target->type->fill_memory || target->state != TARGET_HALTED ||
+			address % data_size)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	target_addr_t start = (address + 7) & ~(target_addr_t)7;
+	target_addr_t end = (address + size) & ~(target_addr_t)7;
+
+	/* small fills are done faster over the debug link */
+	if (end <= start || end - start < 4096)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* The algorithm would overwrite itself, and writes done by the target
+	 * bypass the working area backup and resident algorithm bookkeeping
+	 * of target_write_memory(), so leave such fills to the host. */
+	if (target_overlaps_working_area(target, address, size)) {
+		LOG_DEBUG("fill overlaps the working area, writing it from the host");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	for (unsigned i = 0; i < sizeof(pattern); i += data_size) {
+		switch (data_size) {
+		case 8:
+			target_buffer_set_u64(target, pattern + i, b);
+			break;
+		case 4:
+			target_buffer_set_u32(target, pattern + i, b);
+			break;
+		case 2:
+			target_buffer_set_u16(target, pattern + i, b);
+			break;
+		case 1:
+			target_buffer_set_u8(target, pattern + i, b);
+			break;
+		}
+	}
+
+	int retval = ERROR_OK;
+	for (target_addr_t addr = start; addr < end; ) {
+		uint32_t chunk = MIN(end - addr, 0x40000000);
+		retval = target->type->fill_memory(target, addr, chunk, pattern);
+		if (retval != ERROR_OK)
+			return retval;
+		addr += chunk;
+		keep_alive();
+	}
+
+	/* head and tail are shorter than the pattern */
+	if (start > address)
+		retval = target_write_memory(target, address, data_size,
+				(start - address) / data_size, pattern);
+	if (retval == ERROR_OK && address + size > end)
+		retval = target_write_memory(target, end, data_size,
+				(address + size - end) / data_size, pattern);
+
+	return retval;
+}
+
 static int target_fill_mem(struct target *target,
 		target_addr_t address,
 		target_write_fn fn,
@@ -3456,6 +4261,15 @@ static int target_fill_mem(struct target *target,
 		/* count */
 		unsigned c)
 {
+	/* Large regions are filled by the target itself when possible; the
+	 * algorithms run with the target's view of memory, so physical
+	 * writes always go over the debug link. */
+	if (fn == target_write_memory) {
+		int retval = target_fill_mem_algorithm(target, address, data_size, b, c);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+	}
+
 	/* We have to write in reasonably large chunks to be able
 	 * to fill large memory areas with any sane speed */
 	const unsigned chunk_size = 16384;
@@ -3582,10 +4396,211 @@ static COMMAND_HELPER(parse_load_image_command_CMD_ARGV, struct image *image,
 	return ERROR_OK;
 }
 
+/* load_image streams sections through two buffers of this size */
+#define LOAD_IMAGE_CHUNK_SIZE	(256 * 1024)
+
+struct load_image_chunk {
+	uint8_t *data;
+	size_t size;		/* bytes decoded, 0 once the image is exhausted */
+	unsigned int section;
+	uint32_t offset;	/* offset of data within the section */
+	int retval;
+	/* set when the data is read from the image file by the reader thread */
+	struct fileio *fileio;
+	size_t file_offset;
+	bool pending;
+};
+
+struct load_image_stream {
+	struct image *image;
+	target_addr_t min_address;
+	target_addr_t max_address;
+	/* position of the next chunk to decode */
+	unsigned int section;
+	uint32_t offset;
+};
+
+/*
+ * Binary and ELF section data is read from the image file by one helper
+ * thread while the previous chunk goes out to the target. The thread only
+ * does plain file reads, which don't log; read errors are reported by the
+ * main thread. Other image types are decoded into memory by image_open()
+ * (ihex, srec) or read from a target, so there is nothing to overlap.
+ */
+struct load_image_reader {
+#ifdef HAVE_PTHREAD_H
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct load_image_chunk *queue[2];
+	unsigned int count;
+	bool stop;
+#endif
+	bool running;
+};
+
+#ifdef HAVE_PTHREAD_H
+static void *load_image_reader_thread(void *arg)
+{
+	struct load_image_reader *reader = arg;
+
+	pthread_mutex_lock(&reader->lock);
+	for (;;) {
+		while (reader->count == 0 && !reader->stop)
+			pthread_cond_wait(&reader->cond, &reader->lock);
+		if (reader->count == 0)
+			break;
+		struct load_image_chunk *chunk = reader->queue[0];
+		pthread_mutex_unlock(&reader->lock);
+
+		size_t size_read;
+		chunk->retval = fileio_read_at(chunk->fileio, chunk->file_offset,
+				chunk->size, chunk->data, &size_read);
+		if (chunk->retval == ERROR_OK && size_read != chunk->size)
+			chunk->retval = ERROR_FILEIO_OPERATION_FAILED;
+
+		pthread_mutex_lock(&reader->lock);
+		reader->queue[0] = reader->queue[1];
+		reader->count--;
+		chunk->pending = false;
+		pthread_cond_broadcast(&reader->cond);
+	}
+	pthread_mutex_unlock(&reader->lock);
+
+	return NULL;
+}
+#endif
+
+static void load_image_reader_start(struct load_image_reader *reader)
+{
+	reader->running = false;
+#ifdef HAVE_PTHREAD_H
+	reader->count = 0;
+	reader->stop = false;
+	if (pthread_mutex_init(&reader->lock, NULL) != 0)
+		return;
+	if (pthread_cond_init(&reader->cond, NULL) != 0) {
+		pthread_mutex_destroy(&reader->lock);
+		return;
+	}
+	if (pthread_create(&reader->thread, NULL, load_image_reader_thread, reader) != 0) {
+		pthread_cond_destroy(&reader->cond);
+		pthread_mutex_destroy(&reader->lock);
+		return;
+	}
+	reader->running = true;
+#endif
+}
+
+static void load_image_reader_stop(struct load_image_reader *reader)
+{
+#ifdef HAVE_PTHREAD_H
+	if (!reader->running)
+		return;
+	pthread_mutex_lock(&reader->lock);
+	reader->stop = true;
+	pthread_cond_broadcast(&reader->cond);
+	pthread_mutex_unlock(&reader->lock);
+	pthread_join(reader->thread, NULL);
+	pthread_cond_destroy(&reader->cond);
+	pthread_mutex_destroy(&reader->lock);
+	reader->running = false;
+#endif
+}
+
+/* hand a chunk with a file range to the reader thread */
+static void load_image_reader_submit(struct load_image_reader *reader,
+		struct load_image_chunk *chunk)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&reader->lock);
+	chunk->pending = true;
+	reader->queue[reader->count++] = chunk;
+	pthread_cond_broadcast(&reader->cond);
+	pthread_mutex_unlock(&reader->lock);
+#endif
+}
+
+/* wait for a chunk handed to the reader thread, then report read errors */
+static void load_image_reader_wait(struct load_image_reader *reader,
+		struct load_image_chunk *chunk)
+{
+	if (chunk->fileio == NULL)
+		return;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&reader->lock);
+	while (chunk->pending)
+		pthread_cond_wait(&reader->cond, &reader->lock);
+	pthread_mutex_unlock(&reader->lock);
+#endif
+	if (chunk->retval != ERROR_OK)
+		LOG_ERROR("failed to read %zu bytes of the image file at offset %zu",
+				chunk->size, chunk->file_offset);
+}
+
+/*
+ * Set up the next chunk of the image, skipping sections outside the range.
+ * With a running reader, data stored as is in the image file is left for
+ * the reader thread (chunk->fileio is set); anything else is decoded here.
+ */
+static void load_image_next_chunk(struct load_image_stream *stream,
+		struct load_image_chunk *chunk, struct load_image_reader *reader)
+{
+	struct image *image = stream->image;
+
+	chunk->size = 0;
+	chunk->retval = ERROR_OK;
+	chunk->fileio = NULL;
+
+	while (stream->section < image->num_sections) {
+		struct imagesection *section = &image->sections[stream->section];
+
+		/* DANGER!!! beware of unsigned comparison here!!! */
+		if (stream->offset >= section->size ||
+				section->base_address + section->size < stream->min_address ||
+				section->base_address >= stream->max_address) {
+			stream->section++;
+			stream->offset = 0;
+			continue;
+		}
+
+		uint32_t size = section->size - stream->offset;
+		if (size > LOAD_IMAGE_CHUNK_SIZE)
+			size = LOAD_IMAGE_CHUNK_SIZE;
+
+		chunk->section = stream->section;
+		chunk->offset = stream->offset;
+
+		uint32_t stored = size;
+		if (reader->running && image_section_file_range(image, stream->section,
+					stream->offset, &stored, &chunk->fileio,
+					&chunk->file_offset) == ERROR_OK) {
+			chunk->size = stored;
+		} else {
+			chunk->fileio = NULL;
+			chunk->retval = image_read_section(image, stream->section, stream->offset,
+					size, chunk->data, &chunk->size);
+			if (chunk->retval != ERROR_OK)
+				return;
+		}
+
+		/* a short read means there is nothing more to load in this section */
+		if (chunk->size < size)
+			stream->offset = section->size;
+		else
+			stream->offset += size;
+
+		if (chunk->size) {
+			if (chunk->fileio)
+				load_image_reader_submit(reader, chunk);
+			return;
+		}
+		chunk->fileio = NULL;
+	}
+}
+
 COMMAND_HANDLER(handle_load_image_command)
 {
-	uint8_t *buffer;
-	size_t buf_cnt;
 	uint32_t image_size;
 	target_addr_t min_address = 0;
 	target_addr_t max_address = -1;
@@ -3604,54 +4619,78 @@ COMMAND_HANDLER(handle_load_image_command)
 	if (image_open(&image, CMD_ARGV[0], (CMD_ARGC >= 3) ? CMD_ARGV[2] : NULL) != ERROR_OK)
 		return ERROR_FAIL;
 
-	image_size = 0x0;
-	retval = ERROR_OK;
-	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
+	struct load_image_stream stream = {
+		.image = &image,
+		.min_address = min_address,
+		.max_address = max_address,
+	};
+	struct load_image_chunk chunks[2];
+	struct load_image_chunk *cur = &chunks[0], *next = &chunks[1];
+	struct load_image_reader reader;
+
+	cur->data = malloc(LOAD_IMAGE_CHUNK_SIZE);
+	next->data = malloc(LOAD_IMAGE_CHUNK_SIZE);
+	if (cur->data == NULL || next->data == NULL) {
+		command_print(CMD, "error allocating image buffers (%d bytes)",
+				2 * LOAD_IMAGE_CHUNK_SIZE);
+		free(chunks[0].data);
+		free(chunks[1].data);
+		image_close(&image);
+		return ERROR_FAIL;
+	}
 
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			break;
-		}
+	load_image_reader_start(&reader);
 
-		uint32_t offset = 0;
-		uint32_t length = buf_cnt;
+	/* address range written for the section being loaded */
+	target_addr_t section_start = 0;
+	uint32_t section_length = 0;
 
-		/* DANGER!!! beware of unsigned comparison here!!! */
+	image_size = 0x0;
+	load_image_next_chunk(&stream, cur, &reader);
+	load_image_reader_wait(&reader, cur);
+	retval = cur->retval;
+	while (retval == ERROR_OK && cur->size) {
+		/* the next chunk is read while this one is written */
+		load_image_next_chunk(&stream, next, &reader);
+
+		/* clip the chunk to [min_address, max_address) */
+		target_addr_t start = image.sections[cur->section].base_address + cur->offset;
+		target_addr_t end = start + cur->size;
+		uint32_t offset = 0;
+		if (start < min_address) {
+			offset = min_address - start;
+			start = min_address;
+		}
+		if (end > max_address)
+			end = max_address;
 
-		if ((image.sections[i].base_address + buf_cnt >= min_address) &&
-				(image.sections[i].base_address < max_address)) {
+		if (cur->offset == 0) {
+			section_start = start;
+			section_length = 0;
+		}
 
-			if (image.sections[i].base_address < min_address) {
-				/* clip addresses below */
-				offset += min_address-image.sections[i].base_address;
-				length -= offset;
+		if (start < end) {
+			retval = target_write_buffer(target, start, end - start, cur->data + offset);
+			if (retval == ERROR_OK) {
+				section_length += end - start;
+				image_size += end - start;
 			}
+		}
 
-			if (image.sections[i].base_address + buf_cnt > max_address)
-				length -= (image.sections[i].base_address + buf_cnt)-max_address;
+		load_image_reader_wait(&reader, next);
+		if (retval != ERROR_OK)
+			break;
 
-			retval = target_write_buffer(target,
-					image.sections[i].base_address + offset, length, buffer + offset);
-			if (retval != ERROR_OK) {
-				free(buffer);
-				break;
-			}
-			image_size += length;
+		/* report each section once it has been written completely */
+		if (!next->size || next->section != cur->section)
 			command_print(CMD, "%u bytes written at address " TARGET_ADDR_FMT "",
-					(unsigned int)length,
-					image.sections[i].base_address + offset);
-		}
+					(unsigned int)section_length, section_start);
 
-		free(buffer);
+		struct load_image_chunk *tmp = cur;
+		cur = next;
+		next = tmp;
+		retval = cur->retval;
+		keep_alive();
 	}
 
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
@@ -3660,6 +4699,9 @@ COMMAND_HANDLER(handle_load_image_command)
 				duration_elapsed(&bench), duration_kbps(&bench, image_size));
 	}
 
+	load_image_reader_stop(&reader);
+	free(chunks[0].data);
+	free(chunks[1].data);
 	image_close(&image);
 
 	return retval;
@@ -3734,8 +4776,125 @@ enum verify_mode {
 	IMAGE_CHECKSUM_ONLY = 2
 };
 
-static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode verify)
-{
+/* granularity of the on-target checksums used to locate differences */
+static uint32_t verify_image_block_size = 4096;
+
+struct verify_image_diff {
+	target_addr_t start;	/* start of the pending differing range */
+	uint32_t length;	/* 0 if no range is pending */
+	int count;		/* number of ranges reported so far */
+};
+
+#define VERIFY_IMAGE_MAX_DIFFS	128
+
+/* report the pending range; returns false once the report limit is reached */
+static bool verify_image_flush_diff(struct command_invocation *cmd,
+		struct verify_image_diff *diff)
+{
+	if (diff->length == 0)
+		return true;
+
+	if (diff->count == 0)
+		LOG_ERROR("checksum mismatch - differing ranges follow");
+
+	command_print(cmd, "diff %d address " TARGET_ADDR_FMT " length 0x%08" PRIx32,
+			diff->count, diff->start, diff->length);
+	diff->length = 0;
+
+	if (++diff->count >= VERIFY_IMAGE_MAX_DIFFS) {
+		command_print(cmd, "More than %d differing ranges, the rest are not printed.",
+				VERIFY_IMAGE_MAX_DIFFS - 1);
+		return false;
+	}
+	return true;
+}
+
+/* read back a range of target memory and record the differing ranges */
+static int verify_image_compare(struct command_invocation *cmd, struct target *target,
+		target_addr_t address, const uint8_t *buffer, uint32_t size,
+		struct verify_image_diff *diff)
+{
+	uint8_t *data = malloc(size);
+	if (data == NULL) {
+		LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)", size);
+		return ERROR_FAIL;
+	}
+
+	int retval = target_read_buffer(target, address, size, data);
+	if (retval != ERROR_OK) {
+		free(data);
+		return retval;
+	}
+
+	for (uint32_t t = 0; t < size; t++) {
+		if (data[t] == buffer[t])
+			continue;
+
+		if (diff->length && diff->start + diff->length == address + t) {
+			diff->length++;
+			continue;
+		}
+
+		if (!verify_image_flush_diff(cmd, diff)) {
+			retval = ERROR_FAIL;
+			break;
+		}
+		diff->start = address + t;
+		diff->length = 1;
+	}
+
+	free(data);
+	keep_alive();
+	return retval;
+}
+
+/*
+ * Checksum a range on the target and, on mismatch, split it into halves
+ * at target addresses aligned to verify_image_block_size until single
+ * blocks are left; only those are read back. Ranges whose checksum can't be computed on the
+ * target are compared directly rather than split further, which keeps
+ * targets without a checksum algorithm at one read per section.
+ */
+static int verify_image_range(struct command_invocation *cmd, struct target *target,
+		target_addr_t address, const uint8_t *buffer, uint32_t size,
+		struct verify_image_diff *diff)
+{
+	uint32_t checksum, mem_checksum;
+	int retval;
+
+	if (size == 0)
+		return ERROR_OK;
+
+	if (target->type->checksum_memory == NULL || !target_was_examined(target))
+		return verify_image_compare(cmd, target, address, buffer, size, diff);
+
+	retval = image_calculate_checksum(buffer, size, &checksum);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target->type->checksum_memory(target, address, size, &mem_checksum);
+	if (retval != ERROR_OK)
+		return verify_image_compare(cmd, target, address, buffer, size, diff);
+
+	if (checksum == mem_checksum)
+		return ERROR_OK;
+
+	/* blocks are aligned to target addresses, not to the section start */
+	target_addr_t first = address - (address % verify_image_block_size);
+	uint32_t blocks = DIV_ROUND_UP(address + size - first, verify_image_block_size);
+	if (blocks <= 1)
+		return verify_image_compare(cmd, target, address, buffer, size, diff);
+
+	uint32_t half = first + (blocks / 2) * verify_image_block_size - address;
+	retval = verify_image_range(cmd, target, address, buffer, half, diff);
+	if (retval == ERROR_OK)
+		retval = verify_image_range(cmd, target, address + half, buffer + half,
+				size - half, diff);
+	return retval;
+}
+
+static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode verify)
+{
 	uint8_t *buffer;
 	size_t buf_cnt;
 	uint32_t image_size;
@@ -3775,7 +4934,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 		return retval;
 
 	image_size = 0x0;
-	int diffs = 0;
+	struct verify_image_diff diff = { .length = 0, .count = 0 };
 	retval = ERROR_OK;
 	for (unsigned int i = 0; i < image.num_sections; i++) {
 		buffer = malloc(image.sections[i].size);
@@ -3791,7 +4950,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 			break;
 		}
 
-		if (verify >= IMAGE_VERIFY) {
+		if (verify == IMAGE_CHECKSUM_ONLY) {
 			/* calculate checksum of image */
 			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
 			if (retval != ERROR_OK) {
@@ -3804,43 +4963,20 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 				free(buffer);
 				break;
 			}
-			if ((checksum != mem_checksum) && (verify == IMAGE_CHECKSUM_ONLY)) {
+			if (checksum != mem_checksum) {
 				LOG_ERROR("checksum mismatch");
 				free(buffer);
 				retval = ERROR_FAIL;
 				goto done;
 			}
-			if (checksum != mem_checksum) {
-				/* failed crc checksum, fall back to a binary compare */
-				uint8_t *data;
-
-				if (diffs == 0)
-					LOG_ERROR("checksum mismatch - attempting binary compare");
-
-				data = malloc(buf_cnt);
-
-				retval = target_read_buffer(target, image.sections[i].base_address, buf_cnt, data);
-				if (retval == ERROR_OK) {
-					uint32_t t;
-					for (t = 0; t < buf_cnt; t++) {
-						if (data[t] != buffer[t]) {
-							command_print(CMD,
-										  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
-										  diffs,
-										  (unsigned)(t + image.sections[i].base_address),
-										  data[t],
-										  buffer[t]);
-							if (diffs++ >= 127) {
-								command_print(CMD, "More than 128 errors, the rest are not printed.");
-								free(data);
-								free(buffer);
-								goto done;
-							}
-						}
-						keep_alive();
-					}
-				}
-				free(data);
+		} else if (verify == IMAGE_VERIFY) {
+			retval = verify_image_range(CMD, target, image.sections[i].base_address,
+					buffer, buf_cnt, &diff);
+			if (retval == ERROR_OK && !verify_image_flush_diff(CMD, &diff))
+				retval = ERROR_FAIL;
+			if (retval != ERROR_OK) {
+				free(buffer);
+				goto done;
 			}
 		} else {
 			command_print(CMD, "address " TARGET_ADDR_FMT " length 0x%08zx",
@@ -3851,10 +4987,10 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 		free(buffer);
 		image_size += buf_cnt;
 	}
-	if (diffs > 0)
+	if (diff.count > 0)
 		command_print(CMD, "No more differences found.");
 done:
-	if (diffs > 0)
+	if (diff.count > 0)
 		retval = ERROR_FAIL;
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
 		command_print(CMD, "verified %" PRIu32 " bytes "
@@ -3882,6 +5018,298 @@ COMMAND_HANDLER(handle_test_image_command)
 	return CALL_COMMAND_HANDLER(handle_verify_image_command_internal, IMAGE_TEST);
 }
 
+COMMAND_HANDLER(handle_verify_image_block_size_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		uint32_t size;
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], size);
+		if (size < 4 || (size & (size - 1))) {
+			command_print(CMD, "block size must be a power of two, at least 4");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		verify_image_block_size = size;
+	}
+
+	command_print(CMD, "verify_image block size %" PRIu32, verify_image_block_size);
+	return ERROR_OK;
+}
+
+static struct mem_snapshot *mem_snapshot_find(struct target *target,
+		target_addr_t address, uint32_t size)
+{
+	for (struct mem_snapshot *s = target->mem_snapshots; s; s = s->next) {
+		if (s->address == address && s->size == size)
+			return s;
+	}
+	return NULL;
+}
+
+/* compute the checksum of every block of the snapshot range on the target */
+static int mem_snapshot_checksum(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t block_size, uint32_t *crc)
+{
+	uint32_t blocks = DIV_ROUND_UP(size, block_size);
+
+	for (uint32_t i = 0; i < blocks; i++) {
+		uint32_t offset = i * block_size;
+		int retval = target_checksum_memory(target, address + offset,
+				MIN(block_size, size - offset), &crc[i]);
+		if (retval != ERROR_OK)
+			return retval;
+		keep_alive();
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_mem_snapshot_save_command)
+{
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct target *target = get_current_target(CMD_CTX);
+	target_addr_t address;
+	uint32_t size;
+	uint32_t block_size = verify_image_block_size;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+	if (CMD_ARGC == 3)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], block_size);
+
+	if (size == 0 || block_size == 0) {
+		command_print(CMD, "size and block size must be non-zero");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	if (address + size - 1 < address) {
+		command_print(CMD, "address + size wraps to zero");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	uint32_t blocks = DIV_ROUND_UP(size, block_size);
+	uint32_t *crc = malloc(blocks * sizeof(*crc));
+	if (crc == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	struct duration bench;
+	duration_start(&bench);
+
+	int retval = mem_snapshot_checksum(target, address, size, block_size, crc);
+	if (retval != ERROR_OK) {
+		free(crc);
+		return retval;
+	}
+
+	struct mem_snapshot *snapshot = mem_snapshot_find(target, address, size);
+	if (snapshot == NULL) {
+		snapshot = calloc(1, sizeof(*snapshot));
+		if (snapshot == NULL) {
+			free(crc);
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		snapshot->address = address;
+		snapshot->size = size;
+		snapshot->next = target->mem_snapshots;
+		target->mem_snapshots = snapshot;
+	}
+	free(snapshot->crc);
+	snapshot->crc = crc;
+	snapshot->block_size = block_size;
+
+	if (duration_measure(&bench) == ERROR_OK)
+		command_print(CMD, "saved %" PRIu32 " block checksums of " TARGET_ADDR_FMT
+				" length 0x%" PRIx32 " in %fs", blocks, address, size,
+				duration_elapsed(&bench));
+
+	return ERROR_OK;
+}
+
+/* read back a run of changed blocks, dump it or store it at its offset in the file */
+static int mem_snapshot_fetch(struct command_invocation *cmd, struct target *target,
+		struct fileio *fileio, target_addr_t address, uint32_t offset, uint32_t size)
+{
+	uint8_t *buffer = malloc(size);
+	if (buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = target_read_buffer(target, address + offset, size, buffer);
+	if (retval == ERROR_OK) {
+		if (fileio) {
+			size_t size_written;
+			retval = fileio_seek(fileio, offset);
+			if (retval == ERROR_OK)
+				retval = fileio_write(fileio, size, buffer, &size_written);
+		} else {
+			target_handle_md_output(cmd, target, address + offset, 1, size, buffer);
+		}
+	}
+	free(buffer);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_mem_snapshot_diff_command)
+{
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct target *target = get_current_target(CMD_CTX);
+	target_addr_t address;
+	uint32_t size;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+
+	struct mem_snapshot *snapshot = mem_snapshot_find(target, address, size);
+	if (snapshot == NULL) {
+		command_print(CMD, "no snapshot of " TARGET_ADDR_FMT " length 0x%" PRIx32
+				", use 'mem_snapshot save' first", address, size);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	uint32_t blocks = DIV_ROUND_UP(size, snapshot->block_size);
+	uint32_t *crc = malloc(blocks * sizeof(*crc));
+	if (crc == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = mem_snapshot_checksum(target, address, size, snapshot->block_size, crc);
+	if (retval != ERROR_OK) {
+		free(crc);
+		return retval;
+	}
+
+	struct fileio *fileio = NULL;
+	if (CMD_ARGC == 3) {
+		retval = fileio_open(&fileio, CMD_ARGV[2], FILEIO_WRITE, FILEIO_BINARY);
+		if (retval != ERROR_OK) {
+			free(crc);
+			return retval;
+		}
+	}
+
+	/* fetch runs of adjacent changed blocks as a single range */
+	uint32_t changed = 0;
+	uint32_t run_start = 0;
+	for (uint32_t i = 0; i <= blocks && retval == ERROR_OK; i++) {
+		bool differs = i < blocks && crc[i] != snapshot->crc[i];
+		if (differs) {
+			if (i == 0 || crc[i - 1] == snapshot->crc[i - 1])
+				run_start = i;
+			changed++;
+		} else if (i > 0 && crc[i - 1] != snapshot->crc[i - 1]) {
+			uint32_t start = run_start * snapshot->block_size;
+			uint32_t end = MIN(i * snapshot->block_size, size);
+			command_print(CMD, "changed " TARGET_ADDR_FMT " length 0x%" PRIx32,
+					address + start, end - start);
+			retval = mem_snapshot_fetch(CMD, target, fileio, address, start, end - start);
+		}
+	}
+	free(crc);
+
+	if (fileio) {
+		int retvaltemp = fileio_close(fileio);
+		if (retval == ERROR_OK)
+			retval = retvaltemp;
+	}
+	if (retval != ERROR_OK)
+		return retval;
+
+	command_print(CMD, "%" PRIu32 " of %" PRIu32 " blocks changed", changed, blocks);
+
+	return ERROR_OK;
+}
+
+static const struct command_registration mem_snapshot_command_handlers[] = {
+	{
+		.name = "save",
+		.handler = handle_mem_snapshot_save_command,
+		.mode = COMMAND_EXEC,
+		.help = "save the checksums of the blocks of a memory range",
+		.usage = "address length [block_size]",
+	},
+	{
+		.name = "diff",
+		.handler = handle_mem_snapshot_diff_command,
+		.mode = COMMAND_EXEC,
+		.help = "read back the blocks of a memory range that changed "
+			"since it was saved, optionally into a file",
+		.usage = "address length [filename]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+COMMAND_HANDLER(handle_test_image_checksum_command)
+{
+	uint32_t size = 16 * 1024 * 1024;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], size);
+
+	uint8_t *buffer = malloc(size);
+	if (buffer == NULL) {
+		LOG_ERROR("Unable to allocate memory");
+		return ERROR_FAIL;
+	}
+
+	uint32_t seed = 0x12345678;
+	for (uint32_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		buffer[i] = seed >> 16;
+	}
+
+	const struct image_checksum_impl *selected = image_checksum_get_impl();
+	bool have_reference = false;
+	uint32_t reference = 0;
+	int retval = ERROR_OK;
+
+	/* The last implementation is the plain table lookup, use it as reference */
+	const struct image_checksum_impl *impl = image_checksum_impls;
+	while (impl[1].name)
+		impl++;
+
+	for (; impl >= image_checksum_impls; impl--) {
+		if (!impl->supported()) {
+			command_print(CMD, "%-10s not supported", impl->name);
+			continue;
+		}
+
+		struct duration bench;
+		duration_start(&bench);
+		uint32_t crc = impl->update(0xffffffff, buffer, size);
+		if (duration_measure(&bench) != ERROR_OK)
+			continue;
+
+		if (!have_reference) {
+			reference = crc;
+			have_reference = true;
+		}
+
+		command_print(CMD, "%-10s 0x%08" PRIx32 " in %fs (%0.3f KiB/s)%s%s",
+				impl->name, crc, duration_elapsed(&bench),
+				duration_kbps(&bench, size),
+				impl == selected ? " [selected]" : "",
+				crc != reference ? " MISMATCH" : "");
+		if (crc != reference)
+			retval = ERROR_FAIL;
+		keep_alive();
+	}
+
+	free(buffer);
+	return retval;
+}
+
 static int handle_bp_command_list(struct command_invocation *cmd)
 {
 	struct target *target = get_current_target(cmd->ctx);
@@ -4240,6 +5668,30 @@ static void write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filena
 	fclose(f);
 }
 
+/* Leave the target halted or running, whichever it was before profiling. */
+static int profile_restore_state(struct target *target, bool halted_before_profiling)
+{
+	int retval = target_poll(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (target->state == TARGET_RUNNING && halted_before_profiling) {
+		/* The target was halted before we started and is running now. Halt it,
+		 * for consistency. */
+		retval = target_halt(target);
+		if (retval != ERROR_OK)
+			return retval;
+	} else if (target->state == TARGET_HALTED && !halted_before_profiling) {
+		/* The target was running before we started and is halted now. Resume
+		 * it, for consistency. */
+		retval = target_resume(target, 1, 0, 0, 0);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return target_poll(target);
+}
+
 /* profiling samples the CPU PC as quickly as OpenOCD is able,
  * which will be used as a random sampling of PC */
 COMMAND_HANDLER(handle_profile_command)
@@ -4249,7 +5701,9 @@ COMMAND_HANDLER(handle_profile_command)
 	if ((CMD_ARGC != 2) && (CMD_ARGC != 4))
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	const uint32_t MAX_PROFILE_SAMPLE_NUM = 10000;
+	/* PC sampling backends reach thousands of samples per second; give
+	 * them room for a useful run. */
+	const uint32_t MAX_PROFILE_SAMPLE_NUM = 1000000;
 	uint32_t offset;
 	uint32_t num_of_samples;
 	int retval = ERROR_OK;
@@ -4278,52 +5732,310 @@ COMMAND_HANDLER(handle_profile_command)
 	uint32_t duration_ms = timeval_ms() - timestart_ms;
 
 	assert(num_of_samples <= MAX_PROFILE_SAMPLE_NUM);
+	LOG_INFO("Profiling completed. %" PRIu32 " samples.", num_of_samples);
 
-	retval = target_poll(target);
+	retval = profile_restore_state(target, halted_before_profiling);
 	if (retval != ERROR_OK) {
 		free(samples);
 		return retval;
 	}
 
-	if (target->state == TARGET_RUNNING && halted_before_profiling) {
-		/* The target was halted before we started and is running now. Halt it,
-		 * for consistency. */
-		retval = target_halt(target);
-		if (retval != ERROR_OK) {
-			free(samples);
-			return retval;
-		}
-	} else if (target->state == TARGET_HALTED && !halted_before_profiling) {
-		/* The target was running before we started and is halted now. Resume
-		 * it, for consistency. */
-		retval = target_resume(target, 1, 0, 0, 0);
-		if (retval != ERROR_OK) {
-			free(samples);
-			return retval;
+	uint32_t start_address = 0;
+	uint32_t end_address = 0;
+	bool with_range = false;
+	if (CMD_ARGC == 4) {
+		with_range = true;
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], start_address);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
+	}
+
+	write_gmon(samples, num_of_samples, CMD_ARGV[1],
+		   with_range, start_address, end_address, target, duration_ms);
+	command_print(CMD, "Wrote %s", CMD_ARGV[1]);
+
+	free(samples);
+	return retval;
+}
+
+/* Samples collected per round of a streaming profile run */
+#define PROFILE_STREAM_CHUNK		4096
+/* Deepest caller chain recorded for one sample */
+#define PROFILE_STREAM_MAX_DEPTH	32
+
+enum profile_stream_format {
+	PROFILE_STREAM_FOLDED,
+	PROFILE_STREAM_PERF,
+};
+
+struct profile_stream {
+	struct target *target;
+	FILE *file;
+	enum profile_stream_format format;
+	uint64_t start_ms;
+	uint64_t num_samples;
+};
+
+/* Append one sample to the output; frames[0] is the sampled pc,
+ * followed by its callers, innermost first. */
+static void profile_stream_write(struct profile_stream *stream,
+		const target_addr_t *frames, unsigned int num_frames)
+{
+	if (stream->format == PROFILE_STREAM_FOLDED) {
+		/* Outermost caller first; identical stacks are summed up by
+		 * the consumer, so every line counts one sample. */
+		for (unsigned int i = num_frames; i > 0; i--)
+			fprintf(stream->file, TARGET_ADDR_FMT "%c", frames[i - 1], i > 1 ? ';' : ' ');
+		fputs("1\n", stream->file);
+	} else {
+		uint64_t ms = timeval_ms() - stream->start_ms;
+		fprintf(stream->file, "%s 0 [%03" PRId32 "] %" PRIu64 ".%03" PRIu64 "000: 1 cpu-clock:\n",
+				target_name(stream->target), stream->target->coreid,
+				ms / 1000, ms % 1000);
+		for (unsigned int i = 0; i < num_frames; i++)
+			fprintf(stream->file, "\t%16" TARGET_PRIxADDR " [unknown] ([unknown])\n", frames[i]);
+		fputs("\n", stream->file);
+	}
+	stream->num_samples++;
+}
+
+/* Walk the frame pointer chain of the halted target. Each frame record
+ * holds two words at fp + record_offset: the caller's frame pointer,
+ * then the return address. Both are fetched by a single memory read. */
+static unsigned int profile_stream_backtrace(struct target *target, struct reg *fp_reg,
+		int32_t record_offset, target_addr_t *frames, unsigned int depth)
+{
+	if (!fp_reg->valid && fp_reg->type->get(fp_reg) != ERROR_OK)
+		return 0;
+
+	unsigned int word = fp_reg->size / 8;
+	target_addr_t fp = buf_get_u64(fp_reg->value, 0, fp_reg->size);
+	unsigned int num_frames = 0;
+	uint8_t record[16];
+
+	while (num_frames < depth && fp != 0 && (fp % word) == 0) {
+		if (target_read_memory(target, fp + record_offset, word, 2, record) != ERROR_OK)
+			break;
+
+		target_addr_t caller_fp, return_address;
+		if (word == 8) {
+			caller_fp = target_buffer_get_u64(target, record);
+			return_address = target_buffer_get_u64(target, record + 8);
+		} else {
+			caller_fp = target_buffer_get_u32(target, record);
+			return_address = target_buffer_get_u32(target, record + 4);
+		}
+		if (return_address == 0)
+			break;
+		frames[num_frames++] = return_address;
+
+		/* stacks grow down; a chain that does not move up is corrupt */
+		if (caller_fp <= fp)
+			break;
+		fp = caller_fp;
+	}
+
+	return num_frames;
+}
+
+/* The frame pointer register of the code the halted target is running:
+ * x29 in AArch64 state, r7 in Thumb state (always so on Cortex-M), r11
+ * in ARM state. An explicitly named register is used as is. */
+static struct reg *profile_stream_frame_pointer(struct target *target,
+		struct reg_handle *fp_handle)
+{
+	if (fp_handle->name)
+		return register_handle_get(target->reg_cache, fp_handle, true);
+
+	if (register_get_by_name(target->reg_cache, "xPSR", true))
+		return register_get_by_name(target->reg_cache, "r7", true);
+
+	struct reg *cpsr = register_get_by_name(target->reg_cache, "cpsr", true);
+	if (cpsr == NULL || (!cpsr->valid && cpsr->type->get(cpsr) != ERROR_OK))
+		return NULL;
+
+	uint32_t psr = buf_get_u32(cpsr->value, 0, 32);
+	/* M[4] clear: AArch64 state */
+	if (!(psr & 0x10))
+		return register_get_by_name(target->reg_cache, "x29", true);
+	/* T bit */
+	if (psr & 0x20)
+		return register_get_by_name(target->reg_cache, "r7", true);
+	return register_get_by_name(target->reg_cache, "r11", true);
+}
+
+/* Halt/resume sampling which also records the caller chain. */
+static int profile_stream_halting(struct profile_stream *stream, struct timeval *timeout,
+		struct reg_handle *fp_handle, int32_t record_offset, unsigned int depth)
+{
+	struct target *target = stream->target;
+	struct reg_handle pc_handle = REG_HANDLE_INIT("pc");
+	target_addr_t frames[PROFILE_STREAM_MAX_DEPTH + 1];
+	struct timeval now;
+	int retval = ERROR_OK;
+
+	for (;;) {
+		target_poll(target);
+		if (target->state == TARGET_HALTED) {
+			struct reg *pc = register_handle_get(target->reg_cache, &pc_handle, true);
+			struct reg *fp = profile_stream_frame_pointer(target, fp_handle);
+			if (pc == NULL || fp == NULL || (fp->size != 32 && fp->size != 64)) {
+				LOG_ERROR("Target has no pc or frame pointer register");
+				return ERROR_FAIL;
+			}
+			frames[0] = buf_get_u64(pc->value, 0, pc->size);
+			unsigned int num_frames = 1 + profile_stream_backtrace(target, fp,
+					record_offset, frames + 1, depth);
+			profile_stream_write(stream, frames, num_frames);
+
+			/* current pc, addr = 0, do not handle breakpoints, not debugging */
+			retval = target_resume(target, 1, 0, 0, 0);
+			target_poll(target);
+			alive_sleep(10); /* sleep 10ms, i.e. <100 samples/second. */
+		} else if (target->state == TARGET_RUNNING) {
+			retval = target_halt(target);
+		} else {
+			LOG_INFO("Target not halted or running");
+			break;
+		}
+
+		if (retval != ERROR_OK)
+			break;
+
+		if ((stream->num_samples % 100) == 0)
+			fflush(stream->file);
+
+		gettimeofday(&now, NULL);
+		if (timeval_compare(&now, timeout) >= 0)
+			break;
+	}
+
+	return retval;
+}
+
+/* Drive the target's own profiling method one fixed size chunk at a time. */
+static int profile_stream_chunked(struct profile_stream *stream, struct timeval *timeout)
+{
+	struct target *target = stream->target;
+	struct timeval now;
+	int retval = ERROR_OK;
+
+	uint32_t *samples = malloc(PROFILE_STREAM_CHUNK * sizeof(uint32_t));
+	if (samples == NULL) {
+		LOG_ERROR("No memory to store samples.");
+		return ERROR_FAIL;
+	}
+
+	for (;;) {
+		gettimeofday(&now, NULL);
+		uint32_t seconds = 0;
+		if (timeout->tv_sec > now.tv_sec)
+			seconds = timeout->tv_sec - now.tv_sec;
+
+		uint32_t num_samples = 0;
+		retval = target_profiling(target, samples, PROFILE_STREAM_CHUNK,
+				&num_samples, seconds);
+		if (retval != ERROR_OK)
+			break;
+
+		for (uint32_t i = 0; i < num_samples; i++) {
+			target_addr_t pc = samples[i];
+			profile_stream_write(stream, &pc, 1);
+		}
+		fflush(stream->file);
+
+		/* A short chunk means time ran out or the target stopped */
+		if (num_samples < PROFILE_STREAM_CHUNK)
+			break;
+
+		gettimeofday(&now, NULL);
+		if (timeval_compare(&now, timeout) >= 0)
+			break;
+	}
+
+	free(samples);
+	return retval;
+}
+
+COMMAND_HANDLER(handle_profile_stream_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC < 3 || CMD_ARGC > 6)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct profile_stream stream = { .target = target };
+	uint32_t seconds;
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], seconds);
+
+	if (strcmp(CMD_ARGV[2], "folded") == 0)
+		stream.format = PROFILE_STREAM_FOLDED;
+	else if (strcmp(CMD_ARGV[2], "perf") == 0)
+		stream.format = PROFILE_STREAM_PERF;
+	else
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	uint32_t depth = 0;
+	if (CMD_ARGC > 3)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], depth);
+	if (depth > PROFILE_STREAM_MAX_DEPTH) {
+		command_print(CMD, "stack depth is limited to %d frames", PROFILE_STREAM_MAX_DEPTH);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct reg_handle fp_handle = REG_HANDLE_INIT(NULL);
+	int32_t record_offset = 0;
+	if (CMD_ARGC > 5)
+		COMMAND_PARSE_NUMBER(s32, CMD_ARGV[5], record_offset);
+
+	if (depth > 0) {
+		/* Without a name, the register is picked per sample from the core state */
+		if (CMD_ARGC > 4)
+			fp_handle.name = CMD_ARGV[4];
+
+		bool known = fp_handle.name ?
+			register_handle_get(target->reg_cache, &fp_handle, true) != NULL :
+			register_get_by_name(target->reg_cache, "xPSR", true) != NULL ||
+			register_get_by_name(target->reg_cache, "cpsr", true) != NULL;
+		if (!known) {
+			command_print(CMD, "no usable frame pointer register, name one explicitly");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
 		}
 	}
 
-	retval = target_poll(target);
-	if (retval != ERROR_OK) {
-		free(samples);
-		return retval;
+	stream.file = fopen(CMD_ARGV[1], "w");
+	if (stream.file == NULL) {
+		command_print(CMD, "Can't open %s", CMD_ARGV[1]);
+		return ERROR_FAIL;
 	}
 
-	uint32_t start_address = 0;
-	uint32_t end_address = 0;
-	bool with_range = false;
-	if (CMD_ARGC == 4) {
-		with_range = true;
-		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], start_address);
-		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
+	bool halted_before_profiling = target->state == TARGET_HALTED;
+	struct timeval timeout;
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+	stream.start_ms = timeval_ms();
+
+	/* Only a halted core exposes its frame pointer, so a call graph
+	 * always takes the halting path; PC sampling backends are used
+	 * otherwise. */
+	int retval;
+	if (depth > 0)
+		retval = profile_stream_halting(&stream, &timeout, &fp_handle, record_offset, depth);
+	else
+		retval = profile_stream_chunked(&stream, &timeout);
+
+	if (fclose(stream.file) != 0 && retval == ERROR_OK) {
+		LOG_ERROR("Failed to write %s", CMD_ARGV[1]);
+		retval = ERROR_FAIL;
 	}
+	if (retval != ERROR_OK)
+		return retval;
 
-	write_gmon(samples, num_of_samples, CMD_ARGV[1],
-		   with_range, start_address, end_address, target, duration_ms);
-	command_print(CMD, "Wrote %s", CMD_ARGV[1]);
+	retval = profile_restore_state(target, halted_before_profiling);
+	if (retval != ERROR_OK)
+		return retval;
 
-	free(samples);
-	return retval;
+	command_print(CMD, "Wrote %" PRIu64 " samples to %s", stream.num_samples, CMD_ARGV[1]);
+	return ERROR_OK;
 }
 
 static int new_int_array_element(Jim_Interp *interp, const char *varname, int idx, uint32_t val)
@@ -4731,6 +6443,290 @@ static int target_array2mem(Jim_Interp *interp, struct target *target,
 	return e;
 }
 
+/* transfers of read_memory/write_memory are split so GDB stays alive */
+#define TARGET_JIM_MEMORY_CHUNK	(64 * 1024)
+
+/*
+ * Parse the "address width" leading arguments and the optional trailing
+ * "phys" and "binary" flags shared by read_memory and write_memory.
+ */
+static int target_jim_memory_args(Jim_Interp *interp, int argc, Jim_Obj *const *argv,
+		const char *usage, target_addr_t *address, unsigned int *width,
+		bool *is_phys, bool *binary)
+{
+	jim_wide w;
+
+	if (argc < 3 || argc > 5) {
+		Jim_WrongNumArgs(interp, 0, argv, usage);
+		return JIM_ERR;
+	}
+
+	if (Jim_GetWide(interp, argv[0], &w) != JIM_OK)
+		return JIM_ERR;
+	*address = w;
+
+	if (Jim_GetWide(interp, argv[1], &w) != JIM_OK)
+		return JIM_ERR;
+	if (w != 8 && w != 16 && w != 32 && w != 64) {
+		Jim_SetResultFormatted(interp, "invalid width %#s, must be 8/16/32/64", argv[1]);
+		return JIM_ERR;
+	}
+	*width = w / 8;
+
+	if (*address % *width) {
+		Jim_SetResultFormatted(interp, "address %#s is not aligned for %#s bit access",
+				argv[0], argv[1]);
+		return JIM_ERR;
+	}
+
+	*is_phys = false;
+	*binary = false;
+	for (int i = 3; i < argc; i++) {
+		if (Jim_CompareStringImmediate(interp, argv[i], "phys"))
+			*is_phys = true;
+		else if (Jim_CompareStringImmediate(interp, argv[i], "binary"))
+			*binary = true;
+		else {
+			Jim_WrongNumArgs(interp, 0, argv, usage);
+			return JIM_ERR;
+		}
+	}
+
+	return JIM_OK;
+}
+
+static int target_jim_read_memory(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj *const *argv)
+{
+	target_addr_t address;
+	unsigned int width;
+	bool is_phys, binary;
+	jim_wide count;
+
+	if (target_jim_memory_args(interp, argc, argv, "address width count ['phys'] ['binary']",
+				&address, &width, &is_phys, &binary) != JIM_OK)
+		return JIM_ERR;
+
+	if (Jim_GetWide(interp, argv[2], &count) != JIM_OK)
+		return JIM_ERR;
+	if (count <= 0 || count > INT_MAX / width) {
+		Jim_SetResultFormatted(interp, "invalid count %#s", argv[2]);
+		return JIM_ERR;
+	}
+
+	uint32_t size = count * width;
+	if (address + size - 1 < address) {
+		Jim_SetResultFormatted(interp, "address + count wraps to zero");
+		return JIM_ERR;
+	}
+
+	/* a binary result takes over the buffer read from the target */
+	uint8_t *buffer = binary ? Jim_Alloc(size + 1) : malloc(size);
+	if (buffer == NULL) {
+		Jim_SetResultFormatted(interp, "out of memory");
+		return JIM_ERR;
+	}
+
+	for (uint32_t offset = 0; offset < size; offset += TARGET_JIM_MEMORY_CHUNK) {
+		uint32_t chunk = MIN(size - offset, TARGET_JIM_MEMORY_CHUNK);
+		int retval;
+
+		if (is_phys)
+			retval = target_read_phys_memory(target, address + offset, width,
+					chunk / width, buffer + offset);
+		else
+			retval = target_read_memory(target, address + offset, width,
+					chunk / width, buffer + offset);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("read_memory: read at " TARGET_ADDR_FMT " with width=%u and count=%"
+					PRIu32 " failed", address + offset, width * 8, chunk / width);
+			Jim_SetResultFormatted(interp, "read_memory: cannot read memory");
+			if (binary)
+				Jim_Free(buffer);
+			else
+				free(buffer);
+			return JIM_ERR;
+		}
+		keep_alive();
+	}
+
+	if (binary) {
+		buffer[size] = 0;
+		Jim_SetResult(interp, Jim_NewStringObjNoAlloc(interp, (char *)buffer, size));
+		return JIM_OK;
+	}
+
+	Jim_Obj **elements = malloc(count * sizeof(*elements));
+	if (elements == NULL) {
+		free(buffer);
+		Jim_SetResultFormatted(interp, "out of memory");
+		return JIM_ERR;
+	}
+
+	for (jim_wide i = 0; i < count; i++) {
+		const uint8_t *p = buffer + i * width;
+		uint64_t v;
+
+		switch (width) {
+		case 8:
+			v = target_buffer_get_u64(target, p);
+			break;
+		case 4:
+			v = target_buffer_get_u32(target, p);
+			break;
+		case 2:
+			v = target_buffer_get_u16(target, p);
+			break;
+		default:
+			v = *p;
+			break;
+		}
+		elements[i] = Jim_NewIntObj(interp, (jim_wide)v);
+	}
+
+	Jim_SetResult(interp, Jim_NewListObj(interp, elements, count));
+	free(elements);
+	free(buffer);
+
+	return JIM_OK;
+}
+
+static int target_jim_write_memory(Jim_Interp *interp, struct target *target,
+		int argc, Jim_Obj *const *argv)
+{
+	target_addr_t address;
+	unsigned int width;
+	bool is_phys, binary;
+	const uint8_t *data;
+	uint8_t *buffer = NULL;
+	uint32_t size;
+
+	if (target_jim_memory_args(interp, argc, argv, "address width data ['phys'] ['binary']",
+				&address, &width, &is_phys, &binary) != JIM_OK)
+		return JIM_ERR;
+
+	if (binary) {
+		/* write straight from the string representation */
+		int len;
+		data = (const uint8_t *)Jim_GetString(argv[2], &len);
+		if (len % width) {
+			Jim_SetResultFormatted(interp, "data length %d is not a multiple of %u bytes",
+					len, width);
+			return JIM_ERR;
+		}
+		size = len;
+	} else {
+		int count = Jim_ListLength(interp, argv[2]);
+		if (count > INT_MAX / (int)width) {
+			Jim_SetResultFormatted(interp, "too many elements");
+			return JIM_ERR;
+		}
+		size = count * width;
+		buffer = malloc(size ? size : 1);
+		if (buffer == NULL) {
+			Jim_SetResultFormatted(interp, "out of memory");
+			return JIM_ERR;
+		}
+
+		for (int i = 0; i < count; i++) {
+			Jim_Obj *element;
+			jim_wide v;
+
+			if (Jim_ListIndex(interp, argv[2], i, &element, JIM_ERRMSG) != JIM_OK ||
+					Jim_GetWide(interp, element, &v) != JIM_OK) {
+				free(buffer);
+				return JIM_ERR;
+			}
+
+			uint8_t *p = buffer + i * width;
+			if (width < 8 && ((uint64_t)v >> (width * 8)) != 0) {
+				Jim_SetResultFormatted(interp, "value %#s does not fit in %u bits",
+						element, width * 8);
+				free(buffer);
+				return JIM_ERR;
+			}
+
+			switch (width) {
+			case 8:
+				target_buffer_set_u64(target, p, v);
+				break;
+			case 4:
+				target_buffer_set_u32(target, p, v);
+				break;
+			case 2:
+				target_buffer_set_u16(target, p, v);
+				break;
+			default:
+				*p = v;
+				break;
+			}
+		}
+		data = buffer;
+	}
+
+	if (size && address + size - 1 < address) {
+		Jim_SetResultFormatted(interp, "address + data length wraps to zero");
+		free(buffer);
+		return JIM_ERR;
+	}
+
+	int e = JIM_OK;
+	for (uint32_t offset = 0; offset < size; offset += TARGET_JIM_MEMORY_CHUNK) {
+		uint32_t chunk = MIN(size - offset, TARGET_JIM_MEMORY_CHUNK);
+		int retval;
+
+		if (is_phys)
+			retval = target_write_phys_memory(target, address + offset, width,
+					chunk / width, data + offset);
+		else
+			retval = target_write_memory(target, address + offset, width,
+					chunk / width, data + offset);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("write_memory: write at " TARGET_ADDR_FMT " with width=%u and count=%"
+					PRIu32 " failed", address + offset, width * 8, chunk / width);
+			Jim_SetResultFormatted(interp, "write_memory: cannot write memory");
+			e = JIM_ERR;
+			break;
+		}
+		keep_alive();
+	}
+
+	free(buffer);
+
+	if (e == JIM_OK)
+		Jim_SetEmptyResult(interp);
+
+	return e;
+}
+
+static int jim_read_memory(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	struct command_context *context = current_command_context(interp);
+	assert(context != NULL);
+
+	struct target *target = get_current_target(context);
+	if (target == NULL) {
+		LOG_ERROR("read_memory: no current target");
+		return JIM_ERR;
+	}
+
+	return target_jim_read_memory(interp, target, argc - 1, argv + 1);
+}
+
+static int jim_write_memory(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
+{
+	struct command_context *context = current_command_context(interp);
+	assert(context != NULL);
+
+	struct target *target = get_current_target(context);
+	if (target == NULL) {
+		LOG_ERROR("write_memory: no current target");
+		return JIM_ERR;
+	}
+
+	return target_jim_write_memory(interp, target, argc - 1, argv + 1);
+}
+
 /* FIX? should we propagate errors here rather than printing them
  * and continuing?
  */
@@ -5007,16 +7003,24 @@ no_params:
 		case TCFG_WORK_AREA_BACKUP:
 			if (goi->isconfigure) {
 				target_free_all_working_areas(target);
-				e = Jim_GetOpt_Wide(goi, &w);
-				if (e != JIM_OK)
-					return e;
-				/* make this exactly 1 or 0 */
-				target->backup_working_area = (!!w);
+				if (goi->argc > 0 && Jim_CompareStringImmediate(goi->interp, goi->argv[0], "dirty")) {
+					Jim_GetOpt_Obj(goi, NULL);
+					target->backup_working_area = WORK_AREA_BACKUP_DIRTY;
+				} else {
+					e = Jim_GetOpt_Wide(goi, &w);
+					if (e != JIM_OK)
+						return e;
+					/* make this exactly 1 or 0 */
+					target->backup_working_area = w ? WORK_AREA_BACKUP_FULL : WORK_AREA_BACKUP_NONE;
+				}
 			} else {
 				if (goi->argc != 0)
 					goto no_params;
 			}
-			Jim_SetResult(goi->interp, Jim_NewIntObj(goi->interp, target->backup_working_area));
+			if (target->backup_working_area == WORK_AREA_BACKUP_DIRTY)
+				Jim_SetResultString(goi->interp, "dirty", -1);
+			else
+				Jim_SetResult(goi->interp, Jim_NewIntObj(goi->interp, target->backup_working_area));
 			/* loop for more e*/
 			break;
 
@@ -5189,6 +7193,20 @@ static int jim_target_array2mem(Jim_Interp *interp,
 	return target_array2mem(interp, target, argc - 1, argv + 1);
 }
 
+static int jim_target_read_memory(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	return target_jim_read_memory(interp, target, argc - 1, argv + 1);
+}
+
+static int jim_target_write_memory(Jim_Interp *interp,
+		int argc, Jim_Obj *const *argv)
+{
+	struct target *target = Jim_CmdPrivData(interp);
+	return target_jim_write_memory(interp, target, argc - 1, argv + 1);
+}
+
 static int jim_target_tap_disabled(Jim_Interp *interp)
 {
 	Jim_SetResultFormatted(interp, "[TAP is disabled]");
@@ -5524,6 +7542,22 @@ static const struct command_registration target_instance_command_handlers[] = {
 			"from target memory",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "read_memory",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_read_memory,
+		.help = "Returns a list of 8/16/32/64 bit numbers, or the raw "
+			"bytes, read from target memory",
+		.usage = "address width count ['phys'] ['binary']",
+	},
+	{
+		.name = "write_memory",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_target_write_memory,
+		.help = "Writes a list of 8/16/32/64 bit numbers, or raw "
+			"bytes, to target memory",
+		.usage = "address width data ['phys'] ['binary']",
+	},
 	{
 		.name = "eventlist",
 		.handler = handle_target_event_list,
@@ -5700,7 +7734,7 @@ static int target_create(Jim_GetOptInfo *goi)
 	target->working_area        = 0x0;
 	target->working_area_size   = 0x0;
 	target->working_areas       = NULL;
-	target->backup_working_area = 0;
+	target->backup_working_area = WORK_AREA_BACKUP_NONE;
 
 	target->state               = TARGET_UNKNOWN;
 	target->debug_reason        = DBG_REASON_UNDEFINED;
@@ -6122,6 +8156,34 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_async_algorithm_stats_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct target *target = get_current_target(CMD_CTX);
+	struct async_algorithm_stats *stats = &target->async_stats;
+
+	if (stats->polls == 0) {
+		command_print(CMD, "no asynchronous algorithm has run on %s",
+				target_name(target));
+		return ERROR_OK;
+	}
+
+	double kbps = 0;
+	if (stats->elapsed_ms > 0)
+		kbps = stats->bytes * 1000.0 / 1024.0 / stats->elapsed_ms;
+
+	command_print(CMD, "%" PRIu32 " bytes in %" PRId64 " ms (%0.3f KiB/s)",
+			stats->bytes, stats->elapsed_ms, kbps);
+	command_print(CMD, "%u polls, %u stalls, %u times drained, %u refills",
+			stats->polls, stats->stalls, stats->starved, stats->refills);
+	command_print(CMD, "chunk size %" PRIu32 " bytes, poll interval %u ms",
+			stats->chunk_size, stats->poll_interval);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_fast_load_command)
 {
 	if (CMD_ARGC > 0)
@@ -6403,6 +8465,14 @@ nextw:
 }
 
 static const struct command_registration target_exec_command_handlers[] = {
+	{
+		.name = "async_algorithm_stats",
+		.handler = handle_async_algorithm_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "display statistics of the last asynchronous flash "
+			"algorithm run on the current target",
+		.usage = "",
+	},
 	{
 		.name = "fast_load_image",
 		.handler = handle_fast_load_image_command,
@@ -6427,6 +8497,14 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.usage = "seconds filename [start end]",
 		.help = "profiling samples the CPU PC",
 	},
+	{
+		.name = "profile_stream",
+		.handler = handle_profile_stream_command,
+		.mode = COMMAND_EXEC,
+		.usage = "seconds filename ('folded'|'perf') [depth [fp_register [record_offset]]]",
+		.help = "stream PC samples, optionally with the caller chain, "
+			"to a folded-stack or perf-script file",
+	},
 	/** @todo don't register virt2phys() unless target supports it */
 	{
 		.name = "virt2phys",
@@ -6610,6 +8688,21 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.mode = COMMAND_EXEC,
 		.usage = "filename [offset [type]]",
 	},
+	{
+		.name = "mem_snapshot",
+		.mode = COMMAND_EXEC,
+		.help = "save and compare checksums of target memory blocks",
+		.usage = "",
+		.chain = mem_snapshot_command_handlers,
+	},
+	{
+		.name = "verify_image_block_size",
+		.handler = handle_verify_image_block_size_command,
+		.mode = COMMAND_ANY,
+		.help = "display or set the granularity used by verify_image "
+			"to locate differences",
+		.usage = "[size]",
+	},
 	{
 		.name = "mem2array",
 		.mode = COMMAND_EXEC,
@@ -6626,6 +8719,22 @@ static const struct command_registration target_exec_command_handlers[] = {
 			"and write the 8/16/32 bit values",
 		.usage = "arrayname bitwidth address count",
 	},
+	{
+		.name = "read_memory",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_read_memory,
+		.help = "Returns a list of 8/16/32/64 bit numbers, or the raw "
+			"bytes, read from target memory",
+		.usage = "address width count ['phys'] ['binary']",
+	},
+	{
+		.name = "write_memory",
+		.mode = COMMAND_EXEC,
+		.jim_handler = jim_write_memory,
+		.help = "Writes a list of 8/16/32/64 bit numbers, or raw "
+			"bytes, to target memory",
+		.usage = "address width data ['phys'] ['binary']",
+	},
 	{
 		.name = "reset_nag",
 		.handler = handle_target_reset_nag,
@@ -6648,6 +8757,14 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "Test the target's memory access functions",
 		.usage = "size",
 	},
+	{
+		.name = "test_image_checksum",
+		.handler = handle_test_image_checksum_command,
+		.mode = COMMAND_ANY,
+		.help = "Compare and benchmark the host implementations of "
+			"the image checksum",
+		.usage = "[size]",
+	},
 
 	COMMAND_REGISTRATION_DONE
 };
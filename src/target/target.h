@@ -40,6 +40,7 @@ struct command_context;
 struct command_invocation;
 struct breakpoint;
 struct watchpoint;
+struct bpwp_index;
 struct mem_param;
 struct reg_param;
 struct target_list;
@@ -95,11 +96,29 @@ enum target_endianness {
 	TARGET_BIG_ENDIAN = 1, TARGET_LITTLE_ENDIAN = 2
 };
 
+enum target_work_area_backup {
+	WORK_AREA_BACKUP_NONE = 0,	/* content is not preserved */
+	WORK_AREA_BACKUP_FULL = 1,	/* whole area saved on allocation */
+	WORK_AREA_BACKUP_DIRTY = 2,	/* only ranges written by OpenOCD are saved */
+};
+
+/* A range of a working area, relative to its start address */
+struct working_area_range {
+	uint32_t offset;
+	uint32_t size;
+};
+
 struct working_area {
 	target_addr_t address;
 	uint32_t size;
 	bool free;
 	uint8_t *backup;
+	struct working_area_range *saved;	/* sorted, non-adjacent ranges held in backup */
+	unsigned int num_saved;
+	char *resident;				/* name of the resident algorithm it holds, if any */
+	uint8_t *resident_data;		/* host copy of that algorithm, NULL once overwritten */
+	unsigned int refcount;		/* users of the resident algorithm */
+	unsigned int last_use;		/* for evicting the least recently used one first */
 	struct working_area **user;
 	struct working_area *next;
 };
@@ -113,6 +132,18 @@ struct gdb_service {
 	int32_t core[2];
 };
 
+/* statistics of the last target_run_flash_async_algorithm() run */
+struct async_algorithm_stats {
+	uint32_t bytes;				/* bytes handed to the algorithm */
+	int64_t elapsed_ms;			/* duration of the whole run */
+	unsigned int polls;			/* reads of the fifo read pointer */
+	unsigned int stalls;		/* polls that found too little free space */
+	unsigned int starved;		/* polls that found the fifo drained */
+	unsigned int refills;		/* writes to the fifo */
+	uint32_t chunk_size;		/* final minimum refill size in bytes */
+	unsigned int poll_interval;	/* final poll interval in ms */
+};
+
 /* target back off timer */
 struct backoff_timer {
 	int times;
@@ -125,6 +156,8 @@ enum target_register_class {
 	REG_CLASS_GENERAL,
 };
 
+struct mem_snapshot;
+
 /* target_type.h contains the full definition of struct target_type */
 struct target {
 	struct target_type *type;			/* target type definition (name, access functions) */
@@ -163,7 +196,7 @@ struct target {
 	bool working_area_phys_spec;		/* physical address specified? */
 	target_addr_t working_area_phys;			/* physical address */
 	uint32_t working_area_size;			/* size in bytes */
-	uint32_t backup_working_area;		/* whether the content of the working area has to be preserved */
+	enum target_work_area_backup backup_working_area;	/* whether the content of the working area has to be preserved */
 	struct working_area *working_areas;/* list of allocated working areas */
 	enum target_debug_reason debug_reason;/* reason why the target entered debug state */
 	enum target_endianness endianness;	/* target endianness */
@@ -172,6 +205,7 @@ struct target {
 	struct reg_cache *reg_cache;		/* the first register cache of the target (core regs) */
 	struct breakpoint *breakpoints;		/* list of breakpoints */
 	struct watchpoint *watchpoints;		/* list of watchpoints */
+	struct bpwp_index *bpwp_index;		/* address hash of both lists, see breakpoints.c */
 	struct trace *trace_info;			/* generic trace information */
 	struct debug_msg_receiver *dbgmsg;	/* list of debug message receivers */
 	uint32_t dbg_msg_enabled;			/* debug message status */
@@ -198,6 +232,11 @@ struct target {
 	bool rtos_auto_detect;				/* A flag that indicates that the RTOS has been specified as "auto"
 										 * and must be detected when symbols are offered */
 	struct backoff_timer backoff;
+	unsigned int poll_interval_ms;		/* adaptive polling, see handle_target() */
+	int64_t poll_next_ms;				/* monotonic_ms() time of the next poll */
+	bool poll_due;						/* selected by the current handle_target() run */
+	struct async_algorithm_stats async_stats;	/* see target_run_flash_async_algorithm() */
+	struct mem_snapshot *mem_snapshots;	/* block checksums saved by mem_snapshot */
 	int smp;							/* add some target attributes for smp support */
 	struct target_list *head;
 	/* the gdb service is there in case of smp, we have only one gdb server
@@ -331,9 +370,13 @@ struct target_timer_callback {
 	unsigned int time_ms;
 	enum target_timer_type type;
 	bool removed;
-	struct timeval when;
+	/* deadline in monotonic_ms() time */
+	int64_t when;
 	void *priv;
-	struct target_timer_callback *next;
+	/* position in the deadline ordered heap */
+	unsigned int heap_index;
+	/* last invocation round this callback was called in */
+	unsigned int run;
 };
 
 struct target_memory_check_block {
@@ -405,6 +448,11 @@ int target_call_timer_callbacks(void);
  * a synchronous command completes.
  */
 int target_call_timer_callbacks_now(void);
+/**
+ * Returns the monotonic_ms() time at which the next timer callback is
+ * due, or INT64_MAX if none is registered.
+ */
+int64_t target_timer_next_event(void);
 
 struct target *get_target_by_num(int num);
 struct target *get_current_target(struct command_context *cmd_ctx);
@@ -568,6 +616,10 @@ int target_wait_algorithm(struct target *target,
 /**
  * This routine is a wrapper for asynchronous algorithms.
  *
+ * The fifo is refilled in chunks whose minimum size and the polling
+ * interval adapt to how fast the target drains the fifo compared to
+ * how fast the host fills it. Statistics of the run are left in
+ * target->async_stats.
  */
 int target_run_flash_async_algorithm(struct target *target,
 		const uint8_t *buffer, uint32_t count, int block_size,
@@ -712,6 +764,14 @@ int target_alloc_working_area(struct target *target,
  */
 int target_alloc_working_area_try(struct target *target,
 		uint32_t size, struct working_area **area);
+/* Get a working area holding the given code, uploading it only if no
+ * resident copy of it is left in place by a previous call with the same
+ * name. target_free_working_area() drops the reference but keeps the code
+ * resident; it is evicted when memory runs short, or by
+ * target_free_all_working_areas() upon resuming or resetting the CPU.
+ */
+int target_alloc_resident_working_area(struct target *target, const char *name,
+		const uint8_t *data, uint32_t size, struct working_area **area);
 int target_free_working_area(struct target *target, struct working_area *area);
 void target_free_all_working_areas(struct target *target);
 uint32_t target_get_working_area_avail(struct target *target);
@@ -44,6 +44,10 @@ struct target_type {
 
 	/* poll current target status */
 	int (*poll)(struct target *target);
+	/* Optional: queue, without flushing, the status read the next poll()
+	 * starts with, so one flush serves all cores sharing an adapter.
+	 * poll() may only use the result while target->poll_due is set. */
+	int (*poll_queue)(struct target *target);
 	/* Invoked only from target_arch_state().
 	 * Issue USER() w/architecture specific status.  */
 	int (*arch_state)(struct target *target);
@@ -149,6 +153,15 @@ struct target_type {
 	int (*blank_check_memory)(struct target *target,
 			struct target_memory_check_block *blocks, int num_blocks,
 			uint8_t erased_value);
+	/**
+	 * Fills @a size bytes at the 8 byte aligned @a address by running an
+	 * algorithm on the target; @a size is a non-zero multiple of 8 and
+	 * @a pattern holds the 8 bytes to repeat, in target memory order.
+	 * Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if no working area
+	 * could be allocated. Target-specific, may be NULL.
+	 */
+	int (*fill_memory)(struct target *target, target_addr_t address,
+			uint32_t size, const uint8_t *pattern);
 
 	/*
 	 * target break-/watchpoint control
@@ -233,6 +246,16 @@ struct target_type {
 	 */
 	int (*examine)(struct target *target);
 
+	/**
+	 * Optional: first half of examine(). Locate the debug registers
+	 * and queue, without flushing, the identification reads examine()
+	 * starts with. target_examine() calls this for all targets before
+	 * examining any of them, so the reads of all targets go out in
+	 * shared flushes. examine() must still work when this was not
+	 * called or failed.
+	 */
+	int (*examine_queue)(struct target *target);
+
 	/* Set up structures for target.
 	 *
 	 * It is illegal to talk to the target at this stage as this fn is invoked
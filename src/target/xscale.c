@@ -2876,7 +2876,7 @@ static void xscale_build_reg_cache(struct target *target)
 
 	(*cache_p) = arm_build_reg_cache(target, arm);
 
-	(*cache_p)->next = malloc(sizeof(struct reg_cache));
+	(*cache_p)->next = calloc(1, sizeof(struct reg_cache));
 	cache_p = &(*cache_p)->next;
 
 	/* fill in values for the xscale reg cache */
@@ -2911,6 +2911,7 @@ static void xscale_free_reg_cache(struct target *target)
 
 	free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
+	register_cache_index_free(cache);
 	free(cache);
 
 	arm_free_reg_cache(&xscale->arm);
@@ -3735,6 +3736,7 @@ struct target_type xscale_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
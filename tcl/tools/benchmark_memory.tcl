@@ -0,0 +1,46 @@
+# Compare the speed of the Tcl memory access primitives.
+#
+# Usage, with a halted target and a RAM region that may be read:
+#   source [find tools/benchmark_memory.tcl]
+#   benchmark_memory_access 0x20000000 0x10000
+
+proc benchmark_memory_rate { name bytes start } {
+	set elapsed [expr {[ms] - $start}]
+	if {$elapsed == 0} {
+		set elapsed 1
+	}
+	echo [format "%-24s %8d bytes in %6d ms, %8.1f KiB/s" \
+		$name $bytes $elapsed [expr {$bytes / 1.024 / $elapsed}]]
+}
+
+proc benchmark_memory_access { address size } {
+	set words [expr {$size / 4}]
+	set bytes [expr {$words * 4}]
+
+	# mem2array reads at most 64K elements at once
+	set start [ms]
+	for {set i 0} {$i < $words} {incr i 65536} {
+		set n [expr {$words - $i}]
+		if {$n > 65536} {
+			set n 65536
+		}
+		mem2array values 32 [expr {$address + $i * 4}] $n
+	}
+	benchmark_memory_rate "mem2array" $bytes $start
+
+	set start [ms]
+	set values [read_memory $address 32 $words]
+	benchmark_memory_rate "read_memory" $bytes $start
+
+	set start [ms]
+	set data [read_memory $address 32 $words binary]
+	benchmark_memory_rate "read_memory binary" $bytes $start
+
+	set start [ms]
+	write_memory $address 32 $data binary
+	benchmark_memory_rate "write_memory binary" $bytes $start
+
+	if {[read_memory $address 32 $words binary] ne $data} {
+		error "memory contents changed while benchmarking"
+	}
+}